@@ -26,6 +26,9 @@ ALL_CONFIGS = PLAT_CONFIG.keys()
 TUTORIALS = {
     'hello-world': ALL_CONFIGS,
     'ipc': ALL_CONFIGS,
+    'ipc-bench': ALL_CONFIGS,
+    'timer-wheel-bench': ALL_CONFIGS,
+    'alloc-bench': ALL_CONFIGS,
     'dynamic-1': ALL_CONFIGS,
     'dynamic-2': ALL_CONFIGS,
     'dynamic-3': ALL_CONFIGS,
@@ -41,8 +44,12 @@ TUTORIALS = {
     'camkes-vm-crossvm': ['pc99'],
     'threads': ALL_CONFIGS,
     'notifications': ['pc99'],
+    'ntfn-ring-bench': ['pc99'],
+    'log-ring-bench': ['pc99'],
+    'alloc-mt-test': ['pc99'],
     'mcs': ALL_CONFIGS,
     'interrupts': ['zynq7000'],
+    'timer-deadline-test': ['zynq7000'],
     'fault-handlers': ALL_CONFIGS,
 }
 
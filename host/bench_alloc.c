@@ -0,0 +1,181 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Benchmarks of the allocators in libsel4tutorials against the simulated kernel, on the memory
+ * layouts in sim_machines, printed in the layout of Google Benchmark.
+ *
+ * Each benchmark runs in a process of its own from a fresh boot. The time includes the simulated
+ * kernel, which does far less work than seL4, so only compare times with each other. The number
+ * of kernel invocations per allocation is what carries over to a real machine.
+ *
+ * Pass --benchmark_filter=<regex> to run only the benchmarks whose name matches.
+ */
+
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/alloc.h>
+#include <sel4tutorials/slab.h>
+#include "sim_kernel.h"
+
+/* fewer than the empty slots of the root CNode */
+#define MAX_ITERATIONS 50000
+/* the batch size of alloc_objects, which is in its name */
+#define BATCH 64
+
+typedef struct bench_type {
+    const char *name;
+    seL4_Word type;
+} bench_type_t;
+
+static const bench_type_t bench_types[] = {
+    { "endpoint", seL4_EndpointObject },
+    { "tcb", seL4_TCBObject },
+    { "frame_4k", seL4_X86_4K },
+    { "frame_2m", seL4_X86_LargePageObject },
+};
+
+/* a benchmark makes up to iterations allocations and returns how many it made */
+typedef seL4_Word (*bench_fn_t)(seL4_BootInfo *info, seL4_Word type, seL4_Word iterations);
+
+static seL4_CPtr slots[MAX_ITERATIONS];
+
+static seL4_Word bench_alloc_object(seL4_BootInfo *info, seL4_Word type, seL4_Word iterations)
+{
+    for (seL4_Word i = 0; i < iterations; i++) {
+        slots[i] = alloc_object(info, type, 0);
+    }
+    return iterations;
+}
+
+static seL4_Word bench_alloc_objects(seL4_BootInfo *info, seL4_Word type, seL4_Word iterations)
+{
+    iterations -= iterations % BATCH;
+    for (seL4_Word i = 0; i < iterations; i += BATCH) {
+        alloc_objects(info, type, 0, BATCH, &slots[i]);
+    }
+    return iterations;
+}
+
+/* allocate and free in rounds, so that arenas keep being emptied and revoked */
+static seL4_Word bench_alloc_free(seL4_BootInfo *info, seL4_Word type, seL4_Word iterations)
+{
+    seL4_Word round = MIN(iterations / 10, 4096);
+    for (int r = 0; r < 10; r++) {
+        for (seL4_Word i = 0; i < round; i++) {
+            slots[i] = alloc_object(info, type, 0);
+        }
+        for (seL4_Word i = 0; i < round; i++) {
+            free_object(info, slots[i]);
+        }
+    }
+    return round * 10;
+}
+
+/* allocate and free in rounds through the slab, which keeps up to its capacity of objects */
+static seL4_Word bench_slab(seL4_BootInfo *info, seL4_Word type, seL4_Word iterations)
+{
+    seL4_Word round = MIN(iterations / 10, CONFIG_LIB_SEL4_TUTORIALS_SLAB_CAPACITY * 2);
+    seL4_Word done = 0;
+    while (done + round <= iterations) {
+        for (seL4_Word i = 0; i < round; i++) {
+            slots[i] = slab_alloc(info, type);
+        }
+        for (seL4_Word i = 0; i < round; i++) {
+            slab_free(info, slots[i], type);
+        }
+        done += round;
+    }
+    return done;
+}
+
+typedef struct bench {
+    const char *name;
+    bench_fn_t fn;
+} bench_t;
+
+static const bench_t benches[] = {
+    { "alloc_object", bench_alloc_object },
+    { "alloc_objects/64", bench_alloc_objects },
+    { "alloc_free", bench_alloc_free },
+    { "slab", bench_slab },
+};
+
+static double seconds(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(const bench_t *bench, const bench_type_t *type, const sim_machine_t *machine, const char *name)
+{
+    seL4_BootInfo *info = sim_boot(machine->regions, machine->num_regions);
+    /* leave room for the rounds of alloc_free to be placed anywhere */
+    seL4_Word iterations = MIN(alloc_object_capacity(info, type->type, 0) / 2, MAX_ITERATIONS);
+    if (iterations < BATCH) {
+        printf("%-40s %s\n", name, "skipped, not enough memory");
+        return;
+    }
+
+    double start = seconds(CLOCK_MONOTONIC);
+    double start_cpu = seconds(CLOCK_PROCESS_CPUTIME_ID);
+    seL4_Word allocs = bench->fn(info, type->type, iterations);
+    double elapsed = seconds(CLOCK_MONOTONIC) - start;
+    double cpu = seconds(CLOCK_PROCESS_CPUTIME_ID) - start_cpu;
+
+    printf("%-40s %10.0f ns %10.0f ns %10lu %10.3fM/s %15.4f\n", name, elapsed * 1e9 / allocs, cpu * 1e9 / allocs,
+           (unsigned long) allocs, allocs / elapsed / 1e6, (double) sim_counts.syscalls / allocs);
+}
+
+int main(int argc, char *argv[])
+{
+    regex_t filter;
+    const char *pattern = ".";
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--benchmark_filter=", strlen("--benchmark_filter=")) == 0) {
+            pattern = argv[i] + strlen("--benchmark_filter=");
+        }
+    }
+    if (regcomp(&filter, pattern, REG_EXTENDED | REG_NOSUB) != 0) {
+        fprintf(stderr, "Invalid filter %s\n", pattern);
+        return 1;
+    }
+
+    printf("%-40s %13s %13s %10s %13s %15s\n", "Benchmark", "Time", "CPU", "Iterations", "allocs/s",
+           "syscalls/alloc");
+    for (int b = 0; b < ARRAY_SIZE(benches); b++) {
+        for (int t = 0; t < ARRAY_SIZE(bench_types); t++) {
+            for (seL4_Word m = 0; m < sim_num_machines; m++) {
+                char name[128];
+                snprintf(name, sizeof(name), "%s/%s/%s", benches[b].name, bench_types[t].name, sim_machines[m].name);
+                if (regexec(&filter, name, 0, NULL, 0) != 0) {
+                    continue;
+                }
+                fflush(stdout);
+                pid_t pid = fork();
+                if (pid == 0) {
+                    run(&benches[b], &bench_types[t], &sim_machines[m], name);
+                    exit(0);
+                }
+                int status;
+                waitpid(pid, &status, 0);
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    printf("%-40s failed\n", name);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
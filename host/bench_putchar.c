@@ -0,0 +1,75 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Benchmark of printing 1 MiB through kernel_putchar_write against the simulated kernel, printed
+ * in the layout of Google Benchmark.
+ *
+ * The output is 80 character lines, passed to kernel_putchar_write in the 1 KiB pieces that
+ * musl's stdout buffer writes, and then flushed with fflush. This is built twice, as bench_putchar
+ * with LibSel4TutorialsPutcharBuffer and as bench_putchar_unbuffered without it. seL4 has no debug
+ * call that prints more than one character, so both make a system call for every byte, and the
+ * syscall count shows it.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/debug.h>
+#include <sel4tutorials/gen_config.h>
+#include "sim_kernel.h"
+
+#define TOTAL_BYTES BIT(20)
+#define LINE_LENGTH 80
+/* the size of musl's stdout buffer */
+#define CHUNK 1024
+
+static char output[TOTAL_BYTES];
+
+static double seconds(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void discard(char c)
+{
+}
+
+int main(void)
+{
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER
+    const char *name = "print_1mb/line_buffered";
+#else
+    const char *name = "print_1mb/unbuffered";
+#endif
+    for (seL4_Word i = 0; i < TOTAL_BYTES; i++) {
+        output[i] = i % LINE_LENGTH == LINE_LENGTH - 1 ? '\n' : 'a' + i % 26;
+    }
+    printf("%-40s %13s %13s %10s %15s\n", "Benchmark", "Time", "CPU", "syscalls", "syscalls/line");
+    fflush(stdout);
+    sim_debug_putchar = discard;
+
+    double start = seconds(CLOCK_MONOTONIC);
+    double start_cpu = seconds(CLOCK_PROCESS_CPUTIME_ID);
+    for (seL4_Word i = 0; i < TOTAL_BYTES; i += CHUNK) {
+        sim_stdio_write(&output[i], CHUNK);
+    }
+    fflush(stdout);
+    double elapsed = seconds(CLOCK_MONOTONIC) - start;
+    double cpu = seconds(CLOCK_PROCESS_CPUTIME_ID) - start_cpu;
+
+    if (sim_counts.put_chars != TOTAL_BYTES) {
+        printf("%-40s failed, printed %lu of %lu bytes\n", name, (unsigned long) sim_counts.put_chars,
+               (unsigned long) TOTAL_BYTES);
+        return 1;
+    }
+    printf("%-40s %10.0f us %10.0f us %10lu %15.1f\n", name, elapsed * 1e6, cpu * 1e6,
+           (unsigned long) sim_counts.syscalls, (double) sim_counts.syscalls * LINE_LENGTH / TOTAL_BYTES);
+    return 0;
+}
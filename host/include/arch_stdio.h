@@ -0,0 +1,13 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/* stands in for sel4muslcsys: the simulated kernel keeps the function, see sim_stdio_write */
+typedef size_t (*write_buf_fn)(void *data, size_t count);
+write_buf_fn sel4muslcsys_register_stdio_write_fn(write_buf_fn write_fn);
@@ -0,0 +1,21 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+/* The kernel configuration the host build simulates: an x86_64 debug kernel with MCS, as for
+   the pc99 tutorials. */
+#define CONFIG_ARCH_X86 1
+#define CONFIG_ARCH_X86_64 1
+#define CONFIG_HUGE_PAGE 1
+#define CONFIG_KERNEL_MCS 1
+#define CONFIG_DEBUG_BUILD 1
+#define SEL4_DEBUG_KERNEL 1
+#define CONFIG_WORD_SIZE 64
+#define CONFIG_ROOT_CNODE_SIZE_BITS 16
+#define CONFIG_MAX_NUM_BOOTINFO_UNTYPED_CAPS 230
+#define CONFIG_RETYPE_FAN_OUT_LIMIT 256
+#define CONFIG_MAX_NUM_NODES 1
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+/*
+ * The parts of libsel4 for x86_64 that libsel4tutorials and zynq_timer_driver use, for the host
+ * build. The invocations are implemented by the simulated kernel in kernel.c rather than by
+ * system calls.
+ */
+
+#include <autoconf.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t seL4_Uint8;
+typedef uint16_t seL4_Uint16;
+typedef uint32_t seL4_Uint32;
+typedef uint64_t seL4_Uint64;
+typedef unsigned long seL4_Word;
+typedef seL4_Word seL4_CPtr;
+typedef seL4_Word seL4_Bool;
+
+typedef enum {
+    seL4_NoError = 0,
+    seL4_InvalidArgument,
+    seL4_InvalidCapability,
+    seL4_IllegalOperation,
+    seL4_RangeError,
+    seL4_AlignmentError,
+    seL4_FailedLookup,
+    seL4_TruncatedMessage,
+    seL4_DeleteFirst,
+    seL4_RevokeFirst,
+    seL4_NotEnoughMemory,
+    seL4_NumErrors
+} seL4_Error;
+
+enum {
+    seL4_UntypedObject,
+    seL4_TCBObject,
+    seL4_EndpointObject,
+    seL4_NotificationObject,
+    seL4_CapTableObject,
+    seL4_SchedContextObject,
+    seL4_ReplyObject,
+    seL4_NonArchObjectTypeCount,
+    seL4_X86_PDPTObject = seL4_NonArchObjectTypeCount,
+    seL4_X64_PML4Object,
+    seL4_X64_HugePageObject,
+    seL4_X86_4K,
+    seL4_X86_LargePageObject,
+    seL4_X86_PageTableObject,
+    seL4_X86_PageDirectoryObject,
+    seL4_ObjectTypeCount
+};
+
+#define seL4_WordBits 64
+#define seL4_SlotBits 5
+#define seL4_TCBBits 11
+#define seL4_EndpointBits 4
+#define seL4_NotificationBits 5
+#define seL4_ReplyBits 5
+#define seL4_MinSchedContextBits 8
+#define seL4_MinUntypedBits 4
+#define seL4_MaxUntypedBits 47
+#define seL4_PageBits 12
+#define seL4_LargePageBits 21
+#define seL4_HugePageBits 30
+#define seL4_PageTableBits 12
+#define seL4_PageDirBits 12
+#define seL4_PDPTBits 12
+#define seL4_PML4Bits 12
+#define seL4_MsgMaxLength 120
+#define seL4_FastMessageRegisters 4
+
+enum {
+    seL4_CapNull = 0,
+    seL4_CapInitThreadTCB = 1,
+    seL4_CapInitThreadCNode = 2,
+    seL4_CapInitThreadVSpace = 3,
+    seL4_NumInitialCaps = 16
+};
+
+typedef struct seL4_SlotRegion {
+    seL4_Word start;
+    seL4_Word end;
+} seL4_SlotRegion;
+
+typedef struct seL4_UntypedDesc {
+    seL4_Word paddr;
+    seL4_Uint8 sizeBits;
+    seL4_Uint8 isDevice;
+    seL4_Uint8 padding[sizeof(seL4_Word) - 2];
+} seL4_UntypedDesc;
+
+typedef struct seL4_BootInfo {
+    seL4_Word extraLen;
+    seL4_Word nodeID;
+    seL4_Word numNodes;
+    seL4_Word numIOPTLevels;
+    void *ipcBuffer;
+    seL4_SlotRegion empty;
+    seL4_SlotRegion untyped;
+    seL4_UntypedDesc untypedList[CONFIG_MAX_NUM_BOOTINFO_UNTYPED_CAPS];
+} seL4_BootInfo;
+
+typedef struct seL4_CapRights {
+    seL4_Word words[1];
+} seL4_CapRights_t;
+
+static inline seL4_CapRights_t seL4_CapRights_new(seL4_Word grant_reply, seL4_Word grant, seL4_Word read,
+                                                  seL4_Word write)
+{
+    return (seL4_CapRights_t) {
+        { grant_reply << 3 | grant << 2 | read << 1 | write }
+    };
+}
+
+#define seL4_AllRights seL4_CapRights_new(1, 1, 1, 1)
+#define seL4_CanRead seL4_CapRights_new(0, 0, 1, 0)
+#define seL4_ReadWrite seL4_CapRights_new(0, 0, 1, 1)
+#define seL4_NoRights seL4_CapRights_new(0, 0, 0, 0)
+
+typedef enum {
+    seL4_X86_Default_VMAttributes = 0,
+} seL4_X86_VMAttributes;
+
+typedef struct seL4_MessageInfo {
+    seL4_Word words[1];
+} seL4_MessageInfo_t;
+
+static inline seL4_MessageInfo_t seL4_MessageInfo_new(seL4_Word label, seL4_Word caps_unwrapped,
+                                                      seL4_Word extra_caps, seL4_Word length)
+{
+    return (seL4_MessageInfo_t) {
+        { label << 12 | caps_unwrapped << 9 | extra_caps << 7 | length }
+    };
+}
+
+static inline seL4_Word seL4_MessageInfo_get_length(seL4_MessageInfo_t info)
+{
+    return info.words[0] & 0x7f;
+}
+
+static inline seL4_Word seL4_MessageInfo_get_extraCaps(seL4_MessageInfo_t info)
+{
+    return (info.words[0] >> 7) & 0x3;
+}
+
+static inline seL4_Word seL4_MessageInfo_get_label(seL4_MessageInfo_t info)
+{
+    return info.words[0] >> 12;
+}
+
+seL4_Error seL4_Untyped_Retype(seL4_CPtr service, seL4_Word type, seL4_Word size_bits, seL4_CPtr root,
+                               seL4_Word node_index, seL4_Word node_depth, seL4_Word node_offset,
+                               seL4_Word num_objects);
+
+seL4_Error seL4_CNode_Delete(seL4_CPtr service, seL4_Word index, seL4_Uint8 depth);
+seL4_Error seL4_CNode_Revoke(seL4_CPtr service, seL4_Word index, seL4_Uint8 depth);
+seL4_Error seL4_CNode_Copy(seL4_CPtr service, seL4_Word dest_index, seL4_Uint8 dest_depth, seL4_CPtr src_root,
+                           seL4_Word src_index, seL4_Uint8 src_depth, seL4_CapRights_t rights);
+
+seL4_Error seL4_X86_Page_Map(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr, seL4_CapRights_t rights,
+                             seL4_X86_VMAttributes attr);
+seL4_Error seL4_X86_Page_Unmap(seL4_CPtr service);
+seL4_Error seL4_X86_PageTable_Map(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr, seL4_X86_VMAttributes attr);
+seL4_Error seL4_X86_PageDirectory_Map(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr,
+                                      seL4_X86_VMAttributes attr);
+seL4_Error seL4_X86_PDPT_Map(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr, seL4_X86_VMAttributes attr);
+/* threads are not simulated: these only check that the cap is to a TCB */
+seL4_Error seL4_TCB_Suspend(seL4_CPtr service);
+seL4_Error seL4_TCB_UnbindNotification(seL4_CPtr service);
+
+/* the lookup level a failed map reports, which libsel4 reads from a message register */
+seL4_Word seL4_MappingFailedLookupLevel(void);
+
+/* there is no other thread to talk to: each returns the message it was given */
+seL4_MessageInfo_t seL4_Call(seL4_CPtr dest, seL4_MessageInfo_t info);
+seL4_MessageInfo_t seL4_ReplyRecv(seL4_CPtr src, seL4_MessageInfo_t info, seL4_Word *sender, seL4_CPtr reply);
+
+/* notifications are binary semaphores between host threads, with no badges */
+void seL4_Signal(seL4_CPtr dest);
+void seL4_Wait(seL4_CPtr src, seL4_Word *sender);
+void seL4_Yield(void);
+
+void seL4_DebugPutChar(char c);
+void seL4_DebugNameThread(seL4_CPtr tcb, const char *name);
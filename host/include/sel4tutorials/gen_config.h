@@ -0,0 +1,19 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+/* The libsel4tutorials configuration of the host build, with every optional feature on. */
+#define CONFIG_LIB_SEL4_TUTORIALS_ALLOC_RECLAIM 1
+#define CONFIG_LIB_SEL4_TUTORIALS_ALLOC_STATS 1
+#define CONFIG_LIB_SEL4_TUTORIALS_SLAB_CAPACITY 64
+#define CONFIG_LIB_SEL4_TUTORIALS_TRACE 1
+#define CONFIG_LIB_SEL4_TUTORIALS_NTFN_RING_POLL_SPINS 100
+/* bench_putchar_unbuffered is built without the buffer, to compare against */
+#ifndef HOST_PUTCHAR_UNBUFFERED
+#define CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER 1
+#define CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER_SIZE 128
+#endif
@@ -0,0 +1,10 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#define CONSTRUCTOR(priority) __attribute__((constructor(priority)))
+#define UNUSED __attribute__((unused))
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+/* The parts of libutils that libsel4tutorials and zynq_timer_driver use, for the host build. */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BIT(n) (1ul << (n))
+#define MASK(n) (BIT(n) - 1ul)
+#define ROUND_UP(n, b) (((n) + MASK(b)) & ~MASK(b))
+#define ROUND_DOWN(n, b) (((n) >> (b)) << (b))
+#define IS_ALIGNED(n, b) (!((n) & MASK(b)))
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+#define CTZL(x) __builtin_ctzl(x)
+#define CLZL(x) __builtin_clzl(x)
+#define CTZLL(x) __builtin_ctzll(x)
+#define CLZLL(x) __builtin_clzll(x)
+
+#define UNUSED __attribute__((unused))
+#define COMPILER_MEMORY_FENCE() __atomic_signal_fence(__ATOMIC_ACQ_REL)
+
+#define NS_IN_US 1000ull
+#define NS_IN_MS 1000000ull
+#define NS_IN_S 1000000000ull
+
+static inline uint64_t freq_cycles_and_ns_to_hz(uint64_t cycles, uint64_t ns)
+{
+    return cycles * NS_IN_S / ns;
+}
+
+static inline uint64_t freq_ns_and_hz_to_cycles(uint64_t ns, uint64_t hz)
+{
+    return ns * hz / NS_IN_S;
+}
+
+#define ZF_LOGF(...) do { \
+        fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+        abort(); \
+    } while (0)
+#define ZF_LOGF_IF(cond, ...) do { \
+        if (cond) { \
+            ZF_LOGF(__VA_ARGS__); \
+        } \
+    } while (0)
+#define ZF_LOGF_IFERR(err, ...) ZF_LOGF_IF((err) != seL4_NoError, __VA_ARGS__)
+#define ZF_LOGE(...) do { \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+    } while (0)
+#define ZF_LOGW ZF_LOGE
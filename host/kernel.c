@@ -0,0 +1,709 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arch_stdio.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include "sim_kernel.h"
+
+#define ROOT_CNODE_SLOTS BIT(CONFIG_ROOT_CNODE_SIZE_BITS)
+/* the first slot after the initial caps, where the untypeds start */
+#define FIRST_UNTYPED_SLOT 64
+
+typedef struct object {
+    seL4_Word type;
+    seL4_Word size_bits;
+    seL4_Word paddr;
+    bool is_device;
+    /* bytes of an untyped that have been retyped */
+    seL4_Word watermark;
+    /* number of caps to the object */
+    seL4_Word caps;
+    /* the entries of a paging structure, allocated when the first is filled in */
+    struct object **entries;
+    /* a notification that has been signalled since it was last waited on */
+    bool signalled;
+} object_t;
+
+/*
+ * A slot of the root CNode. Slot 0 never holds a cap, so 0 means none in the links of the
+ * derivation tree: each cap has a parent and a list of children.
+ */
+typedef struct slot {
+    object_t *object;
+    seL4_CPtr parent;
+    seL4_CPtr first_child;
+    seL4_CPtr next_sibling;
+    seL4_CPtr prev_sibling;
+    /* where a frame or paging structure cap is mapped: each cap is mapped on its own */
+    bool mapped;
+    object_t *mapped_vspace;
+    seL4_Word mapped_vaddr;
+} slot_t;
+
+sim_counts_t sim_counts;
+void (*sim_debug_putchar)(char c);
+
+static slot_t cnode[ROOT_CNODE_SLOTS];
+static seL4_BootInfo bootinfo;
+static seL4_Word live_objects;
+static pthread_mutex_t kernel_lock = PTHREAD_MUTEX_INITIALIZER;
+/* broadcast whenever a notification is signalled */
+static pthread_cond_t signalled = PTHREAD_COND_INITIALIZER;
+
+static void enter(void)
+{
+    pthread_mutex_lock(&kernel_lock);
+    sim_counts.syscalls++;
+}
+
+static seL4_Error leave(seL4_Error error)
+{
+    pthread_mutex_unlock(&kernel_lock);
+    return error;
+}
+
+static object_t *new_object(seL4_Word type, seL4_Word size_bits, seL4_Word paddr, bool is_device)
+{
+    object_t *object = calloc(1, sizeof(*object));
+    ZF_LOGF_IF(object == NULL, "Out of host memory");
+    *object = (object_t) {
+        .type = type, .size_bits = size_bits, .paddr = paddr, .is_device = is_device
+    };
+    if (type != seL4_UntypedObject) {
+        live_objects++;
+    }
+    return object;
+}
+
+static void add_child(seL4_CPtr parent, seL4_CPtr child)
+{
+    cnode[child].parent = parent;
+    cnode[child].prev_sibling = 0;
+    cnode[child].next_sibling = parent != 0 ? cnode[parent].first_child : 0;
+    if (cnode[child].next_sibling != 0) {
+        cnode[cnode[child].next_sibling].prev_sibling = child;
+    }
+    if (parent != 0) {
+        cnode[parent].first_child = child;
+    }
+}
+
+static void remove_child(seL4_CPtr child)
+{
+    slot_t *s = &cnode[child];
+    if (s->prev_sibling != 0) {
+        cnode[s->prev_sibling].next_sibling = s->next_sibling;
+    } else if (s->parent != 0) {
+        cnode[s->parent].first_child = s->next_sibling;
+    }
+    if (s->next_sibling != 0) {
+        cnode[s->next_sibling].prev_sibling = s->prev_sibling;
+    }
+    s->parent = s->next_sibling = s->prev_sibling = 0;
+}
+
+static bool is_frame(seL4_Word type)
+{
+    return type == seL4_X86_4K || type == seL4_X86_LargePageObject || type == seL4_X64_HugePageObject;
+}
+
+static bool is_paging_structure(seL4_Word type)
+{
+    return type == seL4_X64_PML4Object || type == seL4_X86_PDPTObject || type == seL4_X86_PageDirectoryObject ||
+           type == seL4_X86_PageTableObject;
+}
+
+/*
+ * The x86_64 paging structures: the PML4 is the VSpace, and an entry at each level resolves 9
+ * bits of the address. A frame sits in the entry whose level matches its size, and a paging
+ * structure in the entry one level above the bits it resolves.
+ */
+#define PML4_SHIFT 39
+#define LEVEL_BITS 9
+
+static __thread seL4_Word failed_lookup_level;
+
+/*
+ * Find the entry that resolves the address bits from shift upwards, or set failed_lookup_level
+ * to the bits left to resolve where a structure on the way is missing. A frame in the way is
+ * as good as missing, as it is for the kernel.
+ */
+static object_t **lookup_entry(object_t *vspace, seL4_Word vaddr, seL4_Word shift)
+{
+    object_t *table = vspace;
+    for (seL4_Word level = PML4_SHIFT; level > shift; level -= LEVEL_BITS) {
+        object_t *next = table->entries != NULL ? table->entries[(vaddr >> level) & MASK(LEVEL_BITS)] : NULL;
+        if (next == NULL || !is_paging_structure(next->type)) {
+            failed_lookup_level = level;
+            return NULL;
+        }
+        table = next;
+    }
+    if (table->entries == NULL) {
+        table->entries = calloc(BIT(LEVEL_BITS), sizeof(object_t *));
+        ZF_LOGF_IF(table->entries == NULL, "Out of host memory");
+    }
+    return &table->entries[(vaddr >> shift) & MASK(LEVEL_BITS)];
+}
+
+/* the lowest address bit resolved by the entry that holds an object */
+static seL4_Word entry_shift(seL4_Word type)
+{
+    switch (type) {
+    case seL4_X86_PDPTObject:
+        return PML4_SHIFT;
+    case seL4_X86_PageDirectoryObject:
+    case seL4_X64_HugePageObject:
+        return seL4_HugePageBits;
+    case seL4_X86_PageTableObject:
+    case seL4_X86_LargePageObject:
+        return seL4_LargePageBits;
+    default:
+        return seL4_PageBits;
+    }
+}
+
+static void unmap_cap(seL4_CPtr slot)
+{
+    slot_t *s = &cnode[slot];
+    if (!s->mapped) {
+        return;
+    }
+    object_t **entry = lookup_entry(s->mapped_vspace, s->mapped_vaddr, entry_shift(s->object->type));
+    if (entry != NULL && *entry == s->object) {
+        *entry = NULL;
+    }
+    s->mapped = false;
+}
+
+static void insert_cap(seL4_CPtr slot, object_t *object, seL4_CPtr parent)
+{
+    cnode[slot].object = object;
+    object->caps++;
+    add_child(parent, slot);
+}
+
+/* delete the cap in a slot, handing its children to its parent */
+static void delete_cap(seL4_CPtr slot)
+{
+    slot_t *s = &cnode[slot];
+    if (s->object == NULL) {
+        return;
+    }
+    seL4_CPtr parent = s->parent;
+    while (s->first_child != 0) {
+        seL4_CPtr child = s->first_child;
+        remove_child(child);
+        add_child(parent, child);
+    }
+    remove_child(slot);
+    unmap_cap(slot);
+
+    object_t *object = s->object;
+    s->object = NULL;
+    if (--object->caps == 0) {
+        if (object->type != seL4_UntypedObject) {
+            live_objects--;
+        }
+        /* a paging structure is kept, as the caps mapped in it still name it in their mapping */
+        if (!is_paging_structure(object->type)) {
+            free(object);
+        }
+    }
+}
+
+static void revoke_cap(seL4_CPtr slot)
+{
+    while (cnode[slot].first_child != 0) {
+        seL4_CPtr child = cnode[slot].first_child;
+        revoke_cap(child);
+        delete_cap(child);
+    }
+}
+
+/* look up a slot of the root CNode the way the library names them */
+static seL4_Error lookup_slot(seL4_CPtr service, seL4_Word index, seL4_Uint8 depth)
+{
+    if (service != seL4_CapInitThreadCNode || depth != seL4_WordBits) {
+        return seL4_FailedLookup;
+    }
+    if (index >= ROOT_CNODE_SLOTS) {
+        return seL4_RangeError;
+    }
+    return seL4_NoError;
+}
+
+/* the size in bits of an object the kernel would create, or 0 if it cannot create one */
+static seL4_Word object_size_bits(seL4_Word type, seL4_Word size_bits, seL4_Error *error)
+{
+    *error = seL4_NoError;
+    switch (type) {
+    case seL4_UntypedObject:
+        if (size_bits < seL4_MinUntypedBits || size_bits > seL4_MaxUntypedBits) {
+            *error = seL4_RangeError;
+        }
+        return size_bits;
+    case seL4_CapTableObject:
+        if (size_bits == 0) {
+            *error = seL4_InvalidArgument;
+        }
+        return size_bits + seL4_SlotBits;
+    case seL4_SchedContextObject:
+        if (size_bits < seL4_MinSchedContextBits || size_bits > seL4_MaxUntypedBits) {
+            *error = seL4_RangeError;
+        }
+        return size_bits;
+    case seL4_TCBObject:
+        return seL4_TCBBits;
+    case seL4_EndpointObject:
+        return seL4_EndpointBits;
+    case seL4_NotificationObject:
+        return seL4_NotificationBits;
+    case seL4_ReplyObject:
+        return seL4_ReplyBits;
+    case seL4_X86_4K:
+        return seL4_PageBits;
+    case seL4_X86_LargePageObject:
+        return seL4_LargePageBits;
+    case seL4_X64_HugePageObject:
+        return seL4_HugePageBits;
+    case seL4_X86_PageTableObject:
+    case seL4_X86_PageDirectoryObject:
+    case seL4_X86_PDPTObject:
+    case seL4_X64_PML4Object:
+        return seL4_PageTableBits;
+    default:
+        *error = seL4_InvalidArgument;
+        return 0;
+    }
+}
+
+seL4_Error seL4_Untyped_Retype(seL4_CPtr service, seL4_Word type, seL4_Word size_bits, seL4_CPtr root,
+                               seL4_Word node_index, seL4_Word node_depth, seL4_Word node_offset,
+                               seL4_Word num_objects)
+{
+    enter();
+    sim_counts.retypes++;
+    seL4_Error error;
+    seL4_Word obj_bits = object_size_bits(type, size_bits, &error);
+    if (error == seL4_NoError && (root != seL4_CapInitThreadCNode || node_depth != 0)) {
+        /* only the root CNode itself can be the destination */
+        error = seL4_FailedLookup;
+    }
+    if (error == seL4_NoError && (num_objects < 1 || num_objects > CONFIG_RETYPE_FAN_OUT_LIMIT ||
+                                  node_offset >= ROOT_CNODE_SLOTS || num_objects > ROOT_CNODE_SLOTS - node_offset)) {
+        error = seL4_RangeError;
+    }
+    object_t *untyped = service < ROOT_CNODE_SLOTS ? cnode[service].object : NULL;
+    if (error == seL4_NoError && (untyped == NULL || untyped->type != seL4_UntypedObject)) {
+        error = seL4_InvalidCapability;
+    }
+    for (seL4_Word i = 0; error == seL4_NoError && i < num_objects; i++) {
+        if (cnode[node_offset + i].object != NULL) {
+            error = seL4_DeleteFirst;
+        }
+    }
+    if (error == seL4_NoError && untyped->is_device && type != seL4_UntypedObject && !is_frame(type)) {
+        error = seL4_InvalidArgument;
+    }
+    if (error == seL4_NoError) {
+        /* an untyped that nothing is derived from any more is reset */
+        if (cnode[service].first_child == 0) {
+            untyped->watermark = 0;
+        }
+        seL4_Word aligned = obj_bits < seL4_WordBits ? ROUND_UP(untyped->watermark, obj_bits) : 0;
+        if (obj_bits > untyped->size_bits || aligned > BIT(untyped->size_bits) ||
+            num_objects > (BIT(untyped->size_bits) - aligned) >> obj_bits) {
+            error = seL4_NotEnoughMemory;
+        } else {
+            for (seL4_Word i = 0; i < num_objects; i++) {
+                object_t *object = new_object(type, obj_bits, untyped->paddr + aligned + (i << obj_bits),
+                                              untyped->is_device);
+                insert_cap(node_offset + i, object, service);
+            }
+            untyped->watermark = aligned + (num_objects << obj_bits);
+        }
+    }
+    if (error != seL4_NoError) {
+        sim_counts.failed_retypes++;
+    }
+    return leave(error);
+}
+
+seL4_Error seL4_CNode_Delete(seL4_CPtr service, seL4_Word index, seL4_Uint8 depth)
+{
+    enter();
+    sim_counts.deletes++;
+    seL4_Error error = lookup_slot(service, index, depth);
+    if (error == seL4_NoError) {
+        delete_cap(index);
+    }
+    return leave(error);
+}
+
+seL4_Error seL4_CNode_Revoke(seL4_CPtr service, seL4_Word index, seL4_Uint8 depth)
+{
+    enter();
+    sim_counts.revokes++;
+    seL4_Error error = lookup_slot(service, index, depth);
+    if (error == seL4_NoError) {
+        revoke_cap(index);
+    }
+    return leave(error);
+}
+
+seL4_Error seL4_CNode_Copy(seL4_CPtr service, seL4_Word dest_index, seL4_Uint8 dest_depth, seL4_CPtr src_root,
+                           seL4_Word src_index, seL4_Uint8 src_depth, seL4_CapRights_t rights)
+{
+    enter();
+    sim_counts.copies++;
+    seL4_Error error = lookup_slot(service, dest_index, dest_depth);
+    if (error == seL4_NoError) {
+        error = lookup_slot(src_root, src_index, src_depth);
+    }
+    if (error == seL4_NoError && cnode[src_index].object == NULL) {
+        error = seL4_FailedLookup;
+    }
+    if (error == seL4_NoError && cnode[dest_index].object != NULL) {
+        error = seL4_DeleteFirst;
+    }
+    if (error == seL4_NoError) {
+        insert_cap(dest_index, cnode[src_index].object, src_index);
+    }
+    return leave(error);
+}
+
+/* map the object of a cap into the entry for vaddr, as the map invocations all do */
+static seL4_Error map_cap(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr, bool frame)
+{
+    object_t *object = service < ROOT_CNODE_SLOTS ? cnode[service].object : NULL;
+    object_t *pml4 = vspace < ROOT_CNODE_SLOTS ? cnode[vspace].object : NULL;
+    if (object == NULL || (frame ? !is_frame(object->type) : !is_paging_structure(object->type)) ||
+        pml4 == NULL || pml4->type != seL4_X64_PML4Object) {
+        return seL4_InvalidCapability;
+    }
+    seL4_Word shift = entry_shift(object->type);
+    if (!IS_ALIGNED(vaddr, shift)) {
+        return seL4_AlignmentError;
+    }
+    if (vaddr >= BIT(PML4_SHIFT + LEVEL_BITS - 1)) {
+        /* the kernel's half of the address space */
+        return seL4_InvalidArgument;
+    }
+    slot_t *s = &cnode[service];
+    if (s->mapped) {
+        /* a frame may only be remapped where it already is, to change its rights */
+        return frame && s->mapped_vspace == pml4 && s->mapped_vaddr == vaddr ? seL4_NoError : seL4_InvalidCapability;
+    }
+    object_t **entry = lookup_entry(pml4, vaddr, shift);
+    if (entry == NULL) {
+        return seL4_FailedLookup;
+    }
+    if (*entry != NULL) {
+        return seL4_DeleteFirst;
+    }
+    *entry = object;
+    s->mapped = true;
+    s->mapped_vspace = pml4;
+    s->mapped_vaddr = vaddr;
+    return seL4_NoError;
+}
+
+seL4_Error seL4_X86_Page_Map(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr, seL4_CapRights_t rights,
+                             seL4_X86_VMAttributes attr)
+{
+    enter();
+    sim_counts.maps++;
+    seL4_Error error = map_cap(service, vspace, vaddr, true);
+    if (error != seL4_NoError) {
+        sim_counts.failed_maps++;
+    }
+    return leave(error);
+}
+
+seL4_Error seL4_X86_Page_Unmap(seL4_CPtr service)
+{
+    enter();
+    sim_counts.unmaps++;
+    object_t *object = service < ROOT_CNODE_SLOTS ? cnode[service].object : NULL;
+    if (object == NULL || !is_frame(object->type)) {
+        return leave(seL4_InvalidCapability);
+    }
+    unmap_cap(service);
+    return leave(seL4_NoError);
+}
+
+static seL4_Error map_paging_structure(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr, seL4_Word type)
+{
+    enter();
+    sim_counts.structure_maps++;
+    seL4_Error error = seL4_IllegalOperation;
+    if (service < ROOT_CNODE_SLOTS && cnode[service].object != NULL && cnode[service].object->type == type) {
+        /* the kernel rounds the address down to what the structure covers */
+        error = map_cap(service, vspace, ROUND_DOWN(vaddr, entry_shift(type)), false);
+    }
+    return leave(error);
+}
+
+seL4_Error seL4_X86_PageTable_Map(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr, seL4_X86_VMAttributes attr)
+{
+    return map_paging_structure(service, vspace, vaddr, seL4_X86_PageTableObject);
+}
+
+seL4_Error seL4_X86_PageDirectory_Map(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr,
+                                      seL4_X86_VMAttributes attr)
+{
+    return map_paging_structure(service, vspace, vaddr, seL4_X86_PageDirectoryObject);
+}
+
+seL4_Error seL4_X86_PDPT_Map(seL4_CPtr service, seL4_CPtr vspace, seL4_Word vaddr, seL4_X86_VMAttributes attr)
+{
+    return map_paging_structure(service, vspace, vaddr, seL4_X86_PDPTObject);
+}
+
+seL4_Word seL4_MappingFailedLookupLevel(void)
+{
+    return failed_lookup_level;
+}
+
+void seL4_DebugPutChar(char c)
+{
+    enter();
+    sim_counts.put_chars++;
+    if (sim_debug_putchar != NULL) {
+        sim_debug_putchar(c);
+    } else {
+        putchar(c);
+    }
+    leave(seL4_NoError);
+}
+
+static seL4_Error tcb_invocation(seL4_CPtr service)
+{
+    enter();
+    object_t *object = service < ROOT_CNODE_SLOTS ? cnode[service].object : NULL;
+    if (object == NULL || object->type != seL4_TCBObject) {
+        return leave(seL4_InvalidCapability);
+    }
+    return leave(seL4_NoError);
+}
+
+seL4_Error seL4_TCB_Suspend(seL4_CPtr service)
+{
+    return tcb_invocation(service);
+}
+
+seL4_Error seL4_TCB_UnbindNotification(seL4_CPtr service)
+{
+    return tcb_invocation(service);
+}
+
+static object_t *notification(seL4_CPtr cap)
+{
+    object_t *object = cap < ROOT_CNODE_SLOTS ? cnode[cap].object : NULL;
+    ZF_LOGF_IF(object == NULL || object->type != seL4_NotificationObject, "Not a notification");
+    return object;
+}
+
+void seL4_Signal(seL4_CPtr dest)
+{
+    enter();
+    sim_counts.signals++;
+    notification(dest)->signalled = true;
+    pthread_cond_broadcast(&signalled);
+    leave(seL4_NoError);
+}
+
+void seL4_Wait(seL4_CPtr src, seL4_Word *sender)
+{
+    enter();
+    sim_counts.waits++;
+    object_t *object = notification(src);
+    while (!object->signalled) {
+        pthread_cond_wait(&signalled, &kernel_lock);
+    }
+    object->signalled = false;
+    if (sender != NULL) {
+        *sender = 0;
+    }
+    leave(seL4_NoError);
+}
+
+void seL4_Yield(void)
+{
+    enter();
+    leave(seL4_NoError);
+    sched_yield();
+}
+
+void seL4_DebugNameThread(seL4_CPtr tcb, const char *name)
+{
+    enter();
+    leave(seL4_NoError);
+}
+
+seL4_MessageInfo_t seL4_Call(seL4_CPtr dest, seL4_MessageInfo_t info)
+{
+    enter();
+    leave(seL4_NoError);
+    return info;
+}
+
+seL4_MessageInfo_t seL4_ReplyRecv(seL4_CPtr src, seL4_MessageInfo_t info, seL4_Word *sender, seL4_CPtr reply)
+{
+    enter();
+    leave(seL4_NoError);
+    return info;
+}
+
+static write_buf_fn stdio_write;
+
+write_buf_fn sel4muslcsys_register_stdio_write_fn(write_buf_fn write_fn)
+{
+    write_buf_fn old = stdio_write;
+    stdio_write = write_fn;
+    return old;
+}
+
+size_t sim_stdio_write(void *data, size_t count)
+{
+    return stdio_write != NULL ? stdio_write(data, count) : count;
+}
+
+static void add_untyped(seL4_Word paddr, seL4_Word size_bits, bool is_device)
+{
+    seL4_Word n = bootinfo.untyped.end - bootinfo.untyped.start;
+    ZF_LOGF_IF(n == CONFIG_MAX_NUM_BOOTINFO_UNTYPED_CAPS, "Too many untypeds");
+    bootinfo.untypedList[n] = (seL4_UntypedDesc) {
+        .paddr = paddr, .sizeBits = size_bits, .isDevice = is_device
+    };
+    insert_cap(bootinfo.untyped.end++, new_object(seL4_UntypedObject, size_bits, paddr, is_device), 0);
+}
+
+seL4_BootInfo *sim_boot(const sim_region_t *regions, seL4_Word num_regions)
+{
+    for (seL4_CPtr slot = 0; slot < ROOT_CNODE_SLOTS; slot++) {
+        if (cnode[slot].object != NULL && --cnode[slot].object->caps == 0) {
+            free(cnode[slot].object);
+        }
+    }
+    memset(cnode, 0, sizeof(cnode));
+    memset(&sim_counts, 0, sizeof(sim_counts));
+    memset(&bootinfo, 0, sizeof(bootinfo));
+    live_objects = 0;
+
+    insert_cap(seL4_CapInitThreadTCB, new_object(seL4_TCBObject, seL4_TCBBits, 0, false), 0);
+    insert_cap(seL4_CapInitThreadCNode,
+               new_object(seL4_CapTableObject, CONFIG_ROOT_CNODE_SIZE_BITS + seL4_SlotBits, 0, false), 0);
+    insert_cap(seL4_CapInitThreadVSpace, new_object(seL4_X64_PML4Object, seL4_PML4Bits, 0, false), 0);
+    live_objects = 0;
+
+    bootinfo.numNodes = 1;
+    bootinfo.untyped.start = bootinfo.untyped.end = FIRST_UNTYPED_SLOT;
+    for (seL4_Word i = 0; i < num_regions; i++) {
+        /* the largest naturally aligned blocks that fit, as the kernel hands out memory */
+        seL4_Word start = regions[i].start;
+        while (start < regions[i].end) {
+            seL4_Word size_bits = seL4_WordBits - 1 - CLZL(regions[i].end - start);
+            if (start != 0) {
+                size_bits = MIN(size_bits, CTZL(start));
+            }
+            size_bits = MIN(size_bits, seL4_MaxUntypedBits);
+            if (size_bits >= seL4_MinUntypedBits) {
+                add_untyped(start, size_bits, regions[i].is_device);
+            }
+            start += BIT(size_bits);
+        }
+    }
+    bootinfo.empty.start = bootinfo.untyped.end;
+    bootinfo.empty.end = ROOT_CNODE_SLOTS;
+    return &bootinfo;
+}
+
+bool sim_cap(seL4_CPtr slot, seL4_Word *type, seL4_Word *paddr)
+{
+    object_t *object = slot < ROOT_CNODE_SLOTS ? cnode[slot].object : NULL;
+    *type = object != NULL ? object->type : seL4_ObjectTypeCount;
+    if (paddr != NULL) {
+        *paddr = object != NULL ? object->paddr : 0;
+    }
+    return object != NULL;
+}
+
+seL4_Word sim_descendants(seL4_CPtr slot)
+{
+    seL4_Word count = 0;
+    for (seL4_CPtr child = cnode[slot].first_child; child != 0; child = cnode[child].next_sibling) {
+        count += 1 + sim_descendants(child);
+    }
+    return count;
+}
+
+bool sim_mapping(seL4_CPtr vspace, seL4_Word vaddr, seL4_Word *type, seL4_Word *paddr)
+{
+    object_t *pml4 = cnode[vspace].object;
+    for (seL4_Word shift = seL4_HugePageBits; shift >= seL4_PageBits; shift -= LEVEL_BITS) {
+        object_t **entry = lookup_entry(pml4, vaddr, shift);
+        if (entry != NULL && *entry != NULL && is_frame((*entry)->type)) {
+            *type = (*entry)->type;
+            *paddr = (*entry)->paddr + (vaddr & MASK(shift));
+            return true;
+        }
+        if (entry == NULL) {
+            break;
+        }
+    }
+    return false;
+}
+
+seL4_Word sim_live_objects(void)
+{
+    return live_objects;
+}
+
+/* QEMU's pc99 with 512 MiB, less the kernel, and the device memory above it */
+static const sim_region_t pc99_regions[] = {
+    { 0x1000, 0x9f000, false },
+    { 0x2a5000, 0x1ffe0000, false },
+    { 0x1ffe0000, 0xfec00000, true },
+    { 0xfec01000, 0xfee00000, true },
+    { 0xfee01000, 0x100000000, true },
+};
+
+/* the Zynq-7000 with 512 MiB, less the kernel, and its peripherals */
+static const sim_region_t zynq7000_regions[] = {
+    { 0x1c3000, 0x20000000, false },
+    { 0xe0000000, 0xe0300000, true },
+    { 0xf8000000, 0xf8f03000, true },
+};
+
+/* memory broken up by reserved regions, so most untypeds are small and few are aligned */
+static const sim_region_t fragmented_regions[] = {
+    { 0x101000, 0x3f5000, false },
+    { 0x417000, 0x9e3000, false },
+    { 0xa00000, 0xa53000, false },
+    { 0x1234000, 0x1fff000, false },
+    { 0x2003000, 0x2c8d000, false },
+    { 0x3001000, 0x3003000, false },
+    { 0x4100000, 0x47ff000, false },
+    { 0x5555000, 0x6000000, false },
+    { 0x6001000, 0x6bcd000, false },
+    { 0xfe000000, 0xfe100000, true },
+};
+
+const sim_machine_t sim_machines[] = {
+    { "pc99", pc99_regions, ARRAY_SIZE(pc99_regions) },
+    { "zynq7000", zynq7000_regions, ARRAY_SIZE(zynq7000_regions) },
+    { "fragmented", fragmented_regions, ARRAY_SIZE(fragmented_regions) },
+};
+
+const seL4_Word sim_num_machines = ARRAY_SIZE(sim_machines);
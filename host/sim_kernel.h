@@ -0,0 +1,105 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <sel4/sel4.h>
+
+/*
+ * A simulated seL4 kernel for running libsel4tutorials on the host.
+ *
+ * It keeps a root CNode of BIT(CONFIG_ROOT_CNODE_SIZE_BITS) slots and the capability derivation
+ * tree between them, and checks invocations the way the kernel does: a retype fails with
+ * seL4_DeleteFirst if a destination slot is in use and with seL4_NotEnoughMemory if the untyped
+ * is full after aligning its watermark, an untyped without children starts again from 0, and a
+ * revoke deletes every cap derived from a slot. The x86_64 paging structures are walked on a
+ * map, which fails with seL4_FailedLookup and the level of the first missing structure, as
+ * seL4_MappingFailedLookupLevel reports it. Objects have no memory behind them. Every invocation
+ * is counted in sim_counts.
+ *
+ * All invocations take one lock, as the kernel does, so they can be made from several threads.
+ */
+
+/*
+ * Write to stdout the way printf does in a root task, through the function registered with
+ * sel4muslcsys_register_stdio_write_fn, which is kernel_putchar_write unless something else has
+ * replaced it. Host printf does not go through it.
+ */
+size_t sim_stdio_write(void *data, size_t count);
+
+/* where seL4_DebugPutChar prints each character, or stdout if it is NULL */
+extern void (*sim_debug_putchar)(char c);
+
+/* a region of physical memory given to sim_boot */
+typedef struct sim_region {
+    seL4_Word start;
+    seL4_Word end;
+    bool is_device;
+} sim_region_t;
+
+typedef struct sim_counts {
+    seL4_Word retypes;
+    seL4_Word failed_retypes;
+    seL4_Word deletes;
+    seL4_Word revokes;
+    seL4_Word copies;
+    /* frame maps, and how many of them failed */
+    seL4_Word maps;
+    seL4_Word failed_maps;
+    seL4_Word unmaps;
+    /* maps of PDPTs, page directories and page tables */
+    seL4_Word structure_maps;
+    seL4_Word put_chars;
+    seL4_Word signals;
+    seL4_Word waits;
+    /* every invocation and system call, including the ones above */
+    seL4_Word syscalls;
+} sim_counts_t;
+
+extern sim_counts_t sim_counts;
+
+/*
+ * Reset the kernel and build the bootinfo for a machine with the given memory.
+ *
+ * Each region is split into the largest naturally aligned untypeds that fit, as the kernel does,
+ * and these follow the initial caps in the root CNode. The empty slots are all the slots after
+ * them.
+ */
+seL4_BootInfo *sim_boot(const sim_region_t *regions, seL4_Word num_regions);
+
+/*
+ * Describe the cap in a slot.
+ *
+ * @param type set to the object type, or seL4_ObjectTypeCount if the slot is empty
+ * @param paddr set to the physical address of the object, if it is not NULL
+ * @return true if the slot holds a cap
+ */
+bool sim_cap(seL4_CPtr slot, seL4_Word *type, seL4_Word *paddr);
+
+/* return the number of caps derived from the cap in a slot, directly or not */
+seL4_Word sim_descendants(seL4_CPtr slot);
+
+/*
+ * Look up the frame mapped at vaddr in a VSpace.
+ *
+ * @param type set to the frame object type
+ * @param paddr set to the physical address vaddr translates to
+ * @return true if a frame is mapped there
+ */
+bool sim_mapping(seL4_CPtr vspace, seL4_Word vaddr, seL4_Word *type, seL4_Word *paddr);
+
+/* return the number of objects that still have a cap to them, not counting untypeds */
+seL4_Word sim_live_objects(void);
+
+/* the named memory layouts of sim_machines, for tests and benchmarks */
+typedef struct sim_machine {
+    const char *name;
+    const sim_region_t *regions;
+    seL4_Word num_regions;
+} sim_machine_t;
+
+extern const sim_machine_t sim_machines[];
+extern const seL4_Word sim_num_machines;
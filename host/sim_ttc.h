@@ -0,0 +1,54 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * A simulated Zynq-7000 triple timer counter, for running zynq_timer_driver on the host.
+ *
+ * The driver reads and writes the registers as plain memory, so the simulation cannot see the
+ * accesses as they happen. Instead time is moved on explicitly with sim_ttc_advance, which counts
+ * each timer at its prescale, wraps it at its interval or at 16 bits, and sets the bits of the
+ * interrupt status register for the interrupts that are enabled. sim_ttc_sync applies a counter
+ * reset or a new prescale written by the driver, and must be called after each call into it.
+ *
+ * Reading the interrupt status register does not clear it, and the event timer registers are
+ * not simulated.
+ */
+
+#define SIM_TTC_TIMERS 3
+/* the TTC's input clock, the CPU_1x clock of a 666 MHz ZC702 */
+#define SIM_TTC_FREQ 111000000ull
+
+typedef struct sim_ttc {
+    /* the registers, which are passed to timer_init as its reg_base */
+    uint32_t regs[32];
+    /* the time in cycles of the input clock */
+    uint64_t cycles;
+    /* the cycles of each timer since its counter last counted, at the prescale it had at the
+       last sim_ttc_sync */
+    uint64_t residue[SIM_TTC_TIMERS];
+    int prescale[SIM_TTC_TIMERS];
+} sim_ttc_t;
+
+void sim_ttc_init(sim_ttc_t *ttc);
+
+/* apply what the driver has written to the registers since the last call */
+void sim_ttc_sync(sim_ttc_t *ttc);
+
+/* move time on by cycles of the input clock */
+void sim_ttc_advance(sim_ttc_t *ttc, uint64_t cycles);
+
+/* @return the cycles until the next interrupt of a timer, or UINT64_MAX if none is coming */
+uint64_t sim_ttc_next_irq(sim_ttc_t *ttc, int timer);
+
+/* @return the counter value of a timer */
+uint32_t sim_ttc_count(sim_ttc_t *ttc, int timer);
+
+/* @return the prescale of a timer: its counter counts every 2^prescale cycles */
+int sim_ttc_prescale(sim_ttc_t *ttc, int timer);
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+/*
+ * The libsel4tutorials sources keep their state in static variables, so every test case runs in
+ * a process of its own: ctest names the case on the command line, and with no arguments every
+ * case is run in a child process one after the other.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+typedef struct test_case {
+    const char *name;
+    void (*fn)(void);
+} test_case_t;
+
+#define TEST_CASE(fn) { #fn, fn }
+
+static inline int test_main(const test_case_t *cases, size_t num_cases, int argc, char *argv[])
+{
+    int failed = 0;
+    for (size_t i = 0; i < num_cases; i++) {
+        if (argc > 1) {
+            if (strcmp(argv[1], cases[i].name) == 0) {
+                cases[i].fn();
+                return 0;
+            }
+            continue;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            cases[i].fn();
+            exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        bool passed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        printf("%s: %s\n", cases[i].name, passed ? "passed" : "FAILED");
+        failed += !passed;
+    }
+    if (argc > 1) {
+        fprintf(stderr, "No test case %s\n", argv[1]);
+        return 1;
+    }
+    return failed != 0;
+}
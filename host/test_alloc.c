@@ -0,0 +1,319 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <pthread.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/alloc.h>
+#include <sel4tutorials/alloc_mt.h>
+#include <sel4tutorials/slab.h>
+#include "sim_kernel.h"
+#include "test.h"
+
+static seL4_BootInfo *boot(const char *name)
+{
+    for (seL4_Word i = 0; i < sim_num_machines; i++) {
+        if (strcmp(sim_machines[i].name, name) == 0) {
+            return sim_boot(sim_machines[i].regions, sim_machines[i].num_regions);
+        }
+    }
+    CHECK(!"no such machine");
+    return NULL;
+}
+
+static void check_cap(seL4_CPtr slot, seL4_Word expected_type)
+{
+    seL4_Word type;
+    CHECK(sim_cap(slot, &type, NULL));
+    CHECK(type == expected_type);
+}
+
+/* a batch is retyped with as few invocations as the fan-out limit allows */
+static void batch_retypes(void)
+{
+    seL4_BootInfo *info = boot("pc99");
+    static seL4_CPtr slots[1000];
+
+    seL4_CPtr first = alloc_objects(info, seL4_EndpointObject, 0, ARRAY_SIZE(slots), slots);
+    for (seL4_Word i = 0; i < ARRAY_SIZE(slots); i++) {
+        CHECK(slots[i] == first + i);
+        check_cap(slots[i], seL4_EndpointObject);
+    }
+    CHECK(sim_counts.retypes == DIV_ROUND_UP(ARRAY_SIZE(slots), CONFIG_RETYPE_FAN_OUT_LIMIT));
+    CHECK(alloc_retype_count() == sim_counts.retypes);
+    CHECK(sim_counts.failed_retypes == 0);
+}
+
+/* the allocator's model of the untypeds never disagrees with the kernel, whatever the mix of
+   sizes, so no retype fails and every object the model has room for can be created */
+static void model_matches_kernel(void)
+{
+    /* weighted towards the small objects, so that memory does not run out before the end */
+    const seL4_Word types[][2] = {
+        { seL4_EndpointObject, 0 },
+        { seL4_EndpointObject, 0 },
+        { seL4_NotificationObject, 0 },
+        { seL4_NotificationObject, 0 },
+        { seL4_X86_4K, 0 },
+        { seL4_X86_4K, 0 },
+        { seL4_TCBObject, 0 },
+        { seL4_CapTableObject, 4 },
+        { seL4_UntypedObject, 12 },
+    };
+    const seL4_Word large_page[] = { seL4_X86_LargePageObject, 0 };
+
+    for (seL4_Word m = 0; m < sim_num_machines; m++) {
+        if (fork() != 0) {
+            int status;
+            wait(&status);
+            CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+            continue;
+        }
+        seL4_BootInfo *info = sim_boot(sim_machines[m].regions, sim_machines[m].num_regions);
+        unsigned int seed = 1;
+        for (int i = 0; i < 10000; i++) {
+            const seL4_Word *t = i % 2000 == 0 ? large_page : types[rand_r(&seed) % ARRAY_SIZE(types)];
+            CHECK(alloc_object_capacity(info, t[0], t[1]) > 0);
+            check_cap(alloc_object(info, t[0], t[1]), t[0]);
+        }
+        /* then fill up what is left, largest first to stay within the slots */
+        const seL4_Word fill[] = { seL4_X86_LargePageObject, seL4_X86_4K, seL4_EndpointObject };
+        for (int i = 0; i < ARRAY_SIZE(fill); i++) {
+            seL4_Word n = alloc_object_capacity(info, fill[i], 0);
+            while (n > 0) {
+                alloc_objects(info, fill[i], 0, MIN(n, 1024), NULL);
+                n -= MIN(n, 1024);
+            }
+        }
+        CHECK(alloc_object_capacity(info, seL4_EndpointObject, 0) == 0);
+        CHECK(sim_counts.failed_retypes == 0);
+        exit(0);
+    }
+}
+
+/* best fit puts an object in the untyped that would have the least room left over */
+static void best_fit(void)
+{
+    seL4_BootInfo *info = boot("fragmented");
+    alloc_set_fit_policy(ALLOC_BEST_FIT);
+
+    seL4_Word best = 0;
+    seL4_Word num_untypeds = info->untyped.end - info->untyped.start;
+    for (seL4_Word i = 0; i < num_untypeds; i++) {
+        seL4_UntypedDesc *desc = &info->untypedList[i];
+        if (!desc->isDevice && desc->sizeBits >= seL4_LargePageBits &&
+            (best == 0 || desc->sizeBits < info->untypedList[best - 1].sizeBits)) {
+            best = i + 1;
+        }
+    }
+    CHECK(best != 0);
+
+    seL4_Word type, paddr;
+    CHECK(sim_cap(alloc_object(info, seL4_X86_LargePageObject, 0), &type, &paddr));
+    CHECK(paddr == info->untypedList[best - 1].paddr);
+}
+
+/* alloc_slot hands back the lowest freed slot before it takes new ones */
+static void free_slot_reuse(void)
+{
+    seL4_BootInfo *info = boot("pc99");
+    seL4_CPtr slots[10];
+
+    for (int i = 0; i < ARRAY_SIZE(slots); i++) {
+        slots[i] = alloc_slot(info);
+    }
+    free_slot(slots[7]);
+    free_slot(slots[3]);
+    CHECK(alloc_slot(info) == slots[3]);
+    CHECK(alloc_slot(info) == slots[7]);
+    CHECK(alloc_slot(info) == slots[9] + 1);
+    CHECK(sim_counts.deletes == 2);
+}
+
+/* once the empty slots are used up, a range comes from a run of freed slots */
+static void slot_range_from_freed(void)
+{
+    seL4_BootInfo *info = boot("pc99");
+
+    seL4_CPtr first = alloc_slot_range(info, 300);
+    for (seL4_Word i = 0; i < 300; i++) {
+        if (i != 100) {
+            free_slot(first + i);
+        }
+    }
+    info->empty.start = info->empty.end;
+    CHECK(alloc_slot_range(info, 150) == first + 101);
+    CHECK(alloc_slot_range(info, 100) == first);
+}
+
+/* objects that are freed give their memory back once the untyped they came from is empty */
+static void free_object_reclaims(void)
+{
+    seL4_BootInfo *info = boot("zynq7000");
+    static seL4_CPtr endpoints[5000];
+    static seL4_CPtr tcbs[100];
+    seL4_Word capacity = alloc_object_capacity(info, seL4_X86_4K, 0);
+
+    for (int round = 0; round < 50; round++) {
+        alloc_objects(info, seL4_EndpointObject, 0, ARRAY_SIZE(endpoints), endpoints);
+        for (int i = 0; i < ARRAY_SIZE(tcbs); i++) {
+            tcbs[i] = alloc_object(info, seL4_TCBObject, 0);
+        }
+        CHECK(sim_live_objects() == ARRAY_SIZE(endpoints) + ARRAY_SIZE(tcbs));
+        for (int i = 0; i < ARRAY_SIZE(endpoints); i++) {
+            free_object(info, endpoints[i]);
+        }
+        for (int i = ARRAY_SIZE(tcbs) - 1; i >= 0; i--) {
+            free_object(info, tcbs[i]);
+        }
+        CHECK(sim_live_objects() == 0);
+        CHECK(alloc_object_capacity(info, seL4_X86_4K, 0) == capacity);
+    }
+    CHECK(sim_counts.failed_retypes == 0);
+}
+
+/* emptying an arena revokes the untyped, which removes copies of the objects' caps */
+static void free_object_revokes_copies(void)
+{
+    seL4_BootInfo *info = boot("pc99");
+
+    seL4_CPtr endpoint = alloc_object(info, seL4_EndpointObject, 0);
+    seL4_CPtr copy = alloc_slot(info);
+    CHECK(seL4_CNode_Copy(seL4_CapInitThreadCNode, copy, seL4_WordBits, seL4_CapInitThreadCNode, endpoint,
+                          seL4_WordBits, seL4_AllRights) == seL4_NoError);
+    free_object(info, endpoint);
+
+    seL4_Word type;
+    CHECK(!sim_cap(endpoint, &type, NULL));
+    CHECK(!sim_cap(copy, &type, NULL));
+    CHECK(sim_live_objects() == 0);
+}
+
+/* device frames are split out of the device untyped that covers them */
+static void device_frames(void)
+{
+    seL4_BootInfo *info = boot("pc99");
+    const seL4_Word frames[][2] = {
+        { 0xfebf0000, seL4_PageBits },
+        { 0xfebf1000, seL4_PageBits },
+        { 0xfe000000, seL4_LargePageBits },
+        { 0xfee01000, seL4_PageBits },
+        { 0x40000000, seL4_HugePageBits },
+    };
+
+    for (int i = 0; i < ARRAY_SIZE(frames); i++) {
+        seL4_Word type, paddr;
+        CHECK(sim_cap(alloc_device_frame(info, frames[i][0], frames[i][1]), &type, &paddr));
+        CHECK(type == alloc_frame_type(frames[i][1]));
+        CHECK(paddr == frames[i][0]);
+    }
+    CHECK(sim_counts.failed_retypes == 0);
+}
+
+/* a slab hands out the objects it was given back before it asks for more */
+static void slab_reuse(void)
+{
+    seL4_BootInfo *info = boot("pc99");
+    seL4_CPtr endpoints[CONFIG_LIB_SEL4_TUTORIALS_SLAB_CAPACITY];
+    slab_stats_t stats;
+
+    for (int i = 0; i < ARRAY_SIZE(endpoints); i++) {
+        endpoints[i] = slab_alloc(info, seL4_EndpointObject);
+    }
+    seL4_Word retypes = sim_counts.retypes;
+    for (int i = 0; i < ARRAY_SIZE(endpoints); i++) {
+        slab_free(info, endpoints[i], seL4_EndpointObject);
+    }
+    for (int i = 0; i < ARRAY_SIZE(endpoints); i++) {
+        check_cap(slab_alloc(info, seL4_EndpointObject), seL4_EndpointObject);
+    }
+    CHECK(sim_counts.retypes == retypes);
+    slab_get_stats(seL4_EndpointObject, &stats);
+    CHECK(stats.hits == ARRAY_SIZE(endpoints) * 2 - 2);
+    CHECK(stats.misses == 2);
+}
+
+/* once the table of device untyped halves is full, frames that need a split are refused and
+   frames that do not can still be made */
+static void device_table_full(void)
+{
+    seL4_BootInfo *info = boot("pc99");
+    const seL4_Word base = 0x40000000;
+    seL4_Word type, paddr;
+    seL4_Word k;
+
+    /* each frame 1 MiB after the last adds the halves of a 1 or 2 MiB untyped to the table */
+    for (k = 0; k < 1000; k++) {
+        seL4_CPtr frame = alloc_device_frame(info, base + k * BIT(20), seL4_PageBits);
+        if (frame == seL4_CapNull) {
+            break;
+        }
+        CHECK(sim_cap(frame, &type, &paddr) && paddr == base + k * BIT(20));
+    }
+    CHECK(k > 0 && k < 1000);
+    /* the page after the last frame is a half of its own that was split off */
+    CHECK(sim_cap(alloc_device_frame(info, base + (k - 1) * BIT(20) + BIT(seL4_PageBits), seL4_PageBits), &type,
+                  &paddr));
+    CHECK(paddr == base + (k - 1) * BIT(20) + BIT(seL4_PageBits));
+    CHECK(sim_counts.failed_retypes == 0);
+}
+
+#define MT_THREADS 4
+#define MT_OBJECTS 2000
+
+static seL4_CPtr mt_slots[MT_THREADS][MT_OBJECTS];
+
+static void *mt_thread(void *arg)
+{
+    seL4_CPtr *slots = arg;
+    alloc_mt_thread_t thread;
+    alloc_mt_thread_init(&thread);
+    for (int i = 0; i < MT_OBJECTS; i++) {
+        slots[i] = alloc_mt_object(&thread, i % 2 ? seL4_EndpointObject : seL4_NotificationObject, 0);
+    }
+    return NULL;
+}
+
+/* threads allocating at once never get the same slot */
+static void alloc_mt_threads(void)
+{
+    seL4_BootInfo *info = boot("pc99");
+    pthread_t threads[MT_THREADS];
+
+    alloc_mt_init(info, MT_THREADS * MT_OBJECTS + MT_THREADS * ALLOC_MT_MAGAZINE_SIZE * 2, 16, 20);
+    for (int i = 0; i < MT_THREADS; i++) {
+        pthread_create(&threads[i], NULL, mt_thread, mt_slots[i]);
+    }
+    for (int i = 0; i < MT_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    for (int t = 0; t < MT_THREADS; t++) {
+        for (int i = 0; i < MT_OBJECTS; i++) {
+            check_cap(mt_slots[t][i], i % 2 ? seL4_EndpointObject : seL4_NotificationObject);
+        }
+    }
+    /* each thread retypes whole magazines of each type */
+    CHECK(sim_live_objects() == MT_THREADS * 2 * ROUND_UP(MT_OBJECTS / 2, 4));
+    CHECK(sim_counts.failed_retypes == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    const test_case_t cases[] = {
+        TEST_CASE(batch_retypes),
+        TEST_CASE(model_matches_kernel),
+        TEST_CASE(best_fit),
+        TEST_CASE(free_slot_reuse),
+        TEST_CASE(slot_range_from_freed),
+        TEST_CASE(free_object_reclaims),
+        TEST_CASE(free_object_revokes_copies),
+        TEST_CASE(device_frames),
+        TEST_CASE(device_table_full),
+        TEST_CASE(slab_reuse),
+        TEST_CASE(alloc_mt_threads),
+    };
+    return test_main(cases, ARRAY_SIZE(cases), argc, argv);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <pthread.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/fastpath.h>
+#include "test.h"
+
+#define THREADS 4
+#define ENDPOINT 10
+
+static char output[4096];
+
+/* run fn in a child process that exits when it returns, and keep what it printed in output */
+static void run_printing(void (*fn)(void))
+{
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        fn();
+        exit(0);
+    }
+    close(fds[1]);
+    size_t len = 0;
+    ssize_t n;
+    while ((n = read(fds[0], output + len, sizeof(output) - 1 - len)) > 0) {
+        len += n;
+    }
+    output[len] = '\0';
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/* the number of times text appears in output */
+static seL4_Word occurrences(const char *text)
+{
+    seL4_Word n = 0;
+    for (const char *p = output; (p = strstr(p, text)) != NULL; p++) {
+        n++;
+    }
+    return n;
+}
+
+/* the calls of a client of ipc-bench: 1100 of each message length, with and without a cap */
+static void *ipc_bench_client(void *arg)
+{
+    seL4_Word lengths[] = {0, 1, 4, seL4_MsgMaxLength};
+    for (int i = 0; i < ARRAY_SIZE(lengths); i++) {
+        for (int cap = 0; cap < 2; cap++) {
+            for (int j = 0; j < 1100; j++) {
+                fastpath_call(ENDPOINT, seL4_MessageInfo_new(0, 0, cap, lengths[i]));
+            }
+        }
+    }
+    return NULL;
+}
+
+static void ipc_bench_clients(void)
+{
+    pthread_t threads[THREADS - 1];
+    /* one client first adds the call site, before the threads could add it twice at once */
+    ipc_bench_client(NULL);
+    for (int i = 0; i < THREADS - 1; i++) {
+        pthread_create(&threads[i], NULL, ipc_bench_client, NULL);
+    }
+    for (int i = 0; i < THREADS - 1; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/* the dump at exit counts every call from every thread, as ipc-bench expects for one client */
+static void dump_counts(void)
+{
+    run_printing(ipc_bench_clients);
+    CHECK(occurrences("fastpath: ") == 1);
+    CHECK(occurrences("fastpath: 22000 of 35200 checked calls cannot take the fastpath\n") == 1);
+    CHECK(occurrences(" seL4_Call: extra caps 17600 long message 8800\n") == 1);
+}
+
+static pthread_barrier_t start;
+
+static void *first_call(void *arg)
+{
+    pthread_barrier_wait(&start);
+    fastpath_reply_recv(ENDPOINT, seL4_MessageInfo_new(0, 0, 0, 1), NULL, 0);
+    return NULL;
+}
+
+static void first_calls_at_once(void)
+{
+    pthread_t threads[THREADS];
+    pthread_barrier_init(&start, NULL, THREADS);
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, first_call, NULL);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/* threads that make their first checked calls at the same time register one dump between them */
+static void dump_registered_once(void)
+{
+    for (int i = 0; i < 100; i++) {
+        run_printing(first_calls_at_once);
+        CHECK(occurrences("fastpath: ") == 1);
+        CHECK(occurrences("fastpath: 0 of 4 checked calls cannot take the fastpath\n") == 1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const test_case_t cases[] = {
+        TEST_CASE(dump_counts),
+        TEST_CASE(dump_registered_once),
+    };
+    return test_main(cases, ARRAY_SIZE(cases), argc, argv);
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/alloc.h>
+#include <sel4tutorials/mapping.h>
+#include <sel4tutorials/slab.h>
+#include "sim_kernel.h"
+#include "test.h"
+
+#define VSPACE seL4_CapInitThreadVSpace
+/* 64 MiB of 4K frames */
+#define FRAMES_64M (BIT(26) >> seL4_PageBits)
+
+static seL4_BootInfo *boot(void)
+{
+    return sim_boot(sim_machines[0].regions, sim_machines[0].num_regions);
+}
+
+/* map a paging structure of the given type at vaddr */
+static void add_structure(seL4_BootInfo *info, seL4_Word type, seL4_Word vaddr)
+{
+    seL4_CPtr cap = alloc_object(info, type, 0);
+    seL4_Error error;
+    switch (type) {
+    case seL4_X86_PDPTObject:
+        error = seL4_X86_PDPT_Map(cap, VSPACE, vaddr, seL4_X86_Default_VMAttributes);
+        break;
+    case seL4_X86_PageDirectoryObject:
+        error = seL4_X86_PageDirectory_Map(cap, VSPACE, vaddr, seL4_X86_Default_VMAttributes);
+        break;
+    default:
+        error = seL4_X86_PageTable_Map(cap, VSPACE, vaddr, seL4_X86_Default_VMAttributes);
+        break;
+    }
+    CHECK(error == seL4_NoError);
+}
+
+/* check that each of n frames from first is mapped in order from vaddr */
+static void check_mapped(seL4_Word vaddr, seL4_CPtr first, seL4_Word frame_bits, seL4_Word n)
+{
+    for (seL4_Word i = 0; i < n; i++) {
+        seL4_Word type, paddr, frame_type, frame_paddr;
+        CHECK(sim_mapping(VSPACE, vaddr + (i << frame_bits), &type, &paddr));
+        CHECK(sim_cap(first + i, &frame_type, &frame_paddr));
+        CHECK(type == frame_type && paddr == frame_paddr);
+    }
+}
+
+/* the numbers quoted for map_region: 64 MiB of 4K frames under a missing page directory takes
+   one failed probe, one retype each for the page directory and the 32 page tables, and 33
+   structure maps */
+static void region_missing_pd(void)
+{
+    seL4_BootInfo *info = boot();
+    const seL4_Word vaddr = 0x10000000;
+    const seL4_Word n = FRAMES_64M;
+    static seL4_CPtr frames[FRAMES_64M];
+
+    add_structure(info, seL4_X86_PDPTObject, vaddr);
+    seL4_CPtr first = alloc_objects(info, seL4_X86_4K, 0, n, frames);
+    sim_counts_t before = sim_counts;
+
+    map_region(info, VSPACE, vaddr, frames, n, seL4_ReadWrite, seL4_X86_Default_VMAttributes);
+    CHECK(sim_counts.failed_maps - before.failed_maps == 1);
+    CHECK(sim_counts.maps - before.maps == n + 1);
+    CHECK(sim_counts.retypes - before.retypes == 2);
+    CHECK(sim_counts.structure_maps - before.structure_maps == 33);
+    check_mapped(vaddr, first, seL4_PageBits, n);
+}
+
+/* with nothing but the PML4, the PDPT is missing too */
+static void region_missing_pdpt(void)
+{
+    seL4_BootInfo *info = boot();
+    const seL4_Word vaddr = 0x8000000000;
+    const seL4_Word n = FRAMES_64M;
+    static seL4_CPtr frames[FRAMES_64M];
+
+    seL4_CPtr first = alloc_objects(info, seL4_X86_4K, 0, n, frames);
+    sim_counts_t before = sim_counts;
+
+    map_region(info, VSPACE, vaddr, frames, n, seL4_ReadWrite, seL4_X86_Default_VMAttributes);
+    CHECK(sim_counts.failed_maps - before.failed_maps == 1);
+    CHECK(sim_counts.retypes - before.retypes == 3);
+    CHECK(sim_counts.structure_maps - before.structure_maps == 34);
+    check_mapped(vaddr, first, seL4_PageBits, n);
+}
+
+/* where some page tables are already there, only the blocks without one fail their probe, and
+   the region may start and end part way through a block */
+static void region_partial(void)
+{
+    seL4_BootInfo *info = boot();
+    const seL4_Word vaddr = 0x201ff000;
+    const seL4_Word n = 2000;
+    seL4_CPtr frames[2000];
+
+    add_structure(info, seL4_X86_PDPTObject, vaddr);
+    add_structure(info, seL4_X86_PageDirectoryObject, vaddr);
+    add_structure(info, seL4_X86_PageTableObject, 0x20000000);
+    add_structure(info, seL4_X86_PageTableObject, 0x20400000);
+    seL4_CPtr first = alloc_objects(info, seL4_X86_4K, 0, n, frames);
+    sim_counts_t before = sim_counts;
+
+    /* the region covers the five blocks from 0x20000000 to 0x20a00000, of which three are missing */
+    map_region(info, VSPACE, vaddr, frames, n, seL4_ReadWrite, seL4_X86_Default_VMAttributes);
+    CHECK(sim_counts.failed_maps - before.failed_maps == 3);
+    CHECK(sim_counts.retypes - before.retypes == 1);
+    CHECK(sim_counts.structure_maps - before.structure_maps == 3);
+    check_mapped(vaddr, first, seL4_PageBits, n);
+}
+
+/* a frame region aligned to a large page is backed by large pages, and only needs page
+   tables for the 4K frames at its ends */
+static void frame_region(void)
+{
+    seL4_BootInfo *info = boot();
+    const seL4_Word vaddr = 0x7fdff000;
+    const seL4_Word size = 0x602000;
+    frame_region_t region;
+
+    CHECK(alloc_frame_region(info, vaddr, size, &region) == seL4_NoError);
+    CHECK(region.num_runs == 3);
+    CHECK(region.runs[0].frame_bits == seL4_PageBits && region.runs[0].count == 1);
+    CHECK(region.runs[1].frame_bits == seL4_LargePageBits && region.runs[1].count == 3);
+    CHECK(region.runs[2].frame_bits == seL4_PageBits && region.runs[2].count == 1);
+
+    sim_counts_t before = sim_counts;
+    map_frame_region(info, VSPACE, &region, seL4_ReadWrite, seL4_X86_Default_VMAttributes);
+    /* a PDPT, two page directories either side of 2 GiB, and a page table at each end */
+    CHECK(sim_counts.structure_maps - before.structure_maps == 5);
+    for (seL4_Word i = 0; i < region.num_runs; i++) {
+        frame_run_t *run = &region.runs[i];
+        check_mapped(run->vaddr, run->first, run->frame_bits, run->count);
+    }
+}
+
+/* deleting a mapped frame cap unmaps it */
+static void delete_unmaps(void)
+{
+    seL4_BootInfo *info = boot();
+    seL4_CPtr frame = alloc_object(info, seL4_X86_4K, 0);
+
+    map_region(info, VSPACE, 0x400000, &frame, 1, seL4_ReadWrite, seL4_X86_Default_VMAttributes);
+    seL4_Word type, paddr;
+    CHECK(sim_mapping(VSPACE, 0x400000, &type, &paddr));
+    free_object(info, frame);
+    CHECK(!sim_mapping(VSPACE, 0x400000, &type, &paddr));
+}
+
+/* a frame freed to its slab while mapped comes back unmapped, so it can be mapped elsewhere */
+static void slab_frame_unmapped(void)
+{
+    seL4_BootInfo *info = boot();
+    seL4_CPtr frame = slab_alloc(info, seL4_X86_4K);
+
+    map_region(info, VSPACE, 0x400000, &frame, 1, seL4_ReadWrite, seL4_X86_Default_VMAttributes);
+    seL4_Word type, paddr;
+    CHECK(sim_mapping(VSPACE, 0x400000, &type, &paddr));
+    slab_free(info, frame, seL4_X86_4K);
+    CHECK(!sim_mapping(VSPACE, 0x400000, &type, &paddr));
+
+    CHECK(slab_alloc(info, seL4_X86_4K) == frame);
+    CHECK(seL4_X86_Page_Map(frame, VSPACE, 0x401000, seL4_ReadWrite, seL4_X86_Default_VMAttributes) == seL4_NoError);
+    CHECK(sim_mapping(VSPACE, 0x401000, &type, &paddr));
+}
+
+int main(int argc, char *argv[])
+{
+    const test_case_t cases[] = {
+        TEST_CASE(region_missing_pd),
+        TEST_CASE(region_missing_pdpt),
+        TEST_CASE(region_partial),
+        TEST_CASE(frame_region),
+        TEST_CASE(delete_unmaps),
+        TEST_CASE(slab_frame_unmapped),
+    };
+    return test_main(cases, ARRAY_SIZE(cases), argc, argv);
+}
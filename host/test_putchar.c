@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <pthread.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/debug.h>
+#include <sel4tutorials/gen_config.h>
+#include "sim_kernel.h"
+#include "test.h"
+
+/* what seL4_DebugPutChar has printed */
+static char printed[1024];
+static size_t num_printed;
+
+static void capture(char c)
+{
+    CHECK(num_printed < sizeof(printed) - 1);
+    printed[num_printed++] = c;
+}
+
+static void write_string(const char *s)
+{
+    sim_debug_putchar = capture;
+    CHECK(sim_stdio_write((void *) s, strlen(s)) == strlen(s));
+}
+
+static void check_printed(const char *s)
+{
+    printed[num_printed] = '\0';
+    CHECK(strcmp(printed, s) == 0);
+    CHECK(sim_counts.put_chars == num_printed);
+}
+
+/* nothing is printed until a newline, and then everything up to it */
+static void newline_flushes(void)
+{
+    write_string("abc");
+    check_printed("");
+    write_string("de\nf");
+    check_printed("abcde\n");
+}
+
+/* a line longer than the buffer is printed in pieces of its size */
+static void full_buffer_flushes(void)
+{
+    char line[CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER_SIZE * 2 + 1];
+    memset(line, 'x', sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    write_string(line);
+    CHECK(num_printed == CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER_SIZE * 2);
+}
+
+/* fflush prints the part of a line in the buffer, as well as flushing the C library */
+static void fflush_flushes(void)
+{
+    write_string("partial");
+    check_printed("");
+    fflush(stdout);
+    check_printed("partial");
+    write_string("more");
+    fflush(NULL);
+    check_printed("partialmore");
+}
+
+static void *write_line(void *arg)
+{
+    write_string(arg);
+    return NULL;
+}
+
+/* each thread has a buffer of its own, so a line is not printed in the middle of another */
+static void threads_have_own_buffers(void)
+{
+    pthread_t thread;
+    write_string("first ");
+    pthread_create(&thread, NULL, write_line, "other\n");
+    pthread_join(thread, NULL);
+    write_string("line\n");
+    check_printed("other\nfirst line\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const test_case_t cases[] = {
+        TEST_CASE(newline_flushes),
+        TEST_CASE(full_buffer_flushes),
+        TEST_CASE(fflush_flushes),
+        TEST_CASE(threads_have_own_buffers),
+    };
+    return test_main(cases, ARRAY_SIZE(cases), argc, argv);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <pthread.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/alloc.h>
+#include <sel4tutorials/ntfn_ring.h>
+#include "sim_kernel.h"
+#include "test.h"
+
+#define PRODUCERS 3
+#define ITEMS 200000
+#define MAX_BATCH 16
+
+/* a ring of 64 items of a word each, with room to spare that it must not use */
+static char buf[sizeof(ntfn_ring_t) + 100 * sizeof(seL4_Word)];
+static ntfn_ring_t *ring;
+static seL4_CPtr ntfn;
+
+static seL4_BootInfo *boot(void)
+{
+    return sim_boot(sim_machines[0].regions, sim_machines[0].num_regions);
+}
+
+/* items taken out come back in the order they went in, across the end of the ring */
+static void items_wrap(void)
+{
+    typedef struct item {
+        seL4_Word seq;
+        char pad[13];
+    } item_t;
+    item_t in[5], out[5];
+    seL4_Word next_in = 0, next_out = 0;
+    ntfn = alloc_object(boot(), seL4_NotificationObject, 0);
+    ring = ntfn_ring_init(buf, sizeof(buf), sizeof(item_t));
+    CHECK(ring->size == 32);
+
+    CHECK(ntfn_ring_dequeue(ring, out, ARRAY_SIZE(out)) == 0);
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < ARRAY_SIZE(in); i++) {
+            in[i].seq = next_in + i;
+        }
+        next_in += ntfn_ring_enqueue(ring, in, ARRAY_SIZE(in), ntfn);
+        size_t n = ntfn_ring_dequeue(ring, out, 3);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(out[i].seq == next_out++);
+        }
+    }
+    /* the ring filled up, and since then enqueue has only taken as much as fitted */
+    CHECK(next_in - next_out == ring->size - 3);
+    CHECK(ntfn_ring_enqueue(ring, in, ARRAY_SIZE(in), ntfn) == 3);
+}
+
+static void *producer(void *arg)
+{
+    seL4_Word id = (seL4_Word) arg;
+    seL4_Word items[MAX_BATCH];
+    seL4_Word sent = 0;
+    while (sent < ITEMS) {
+        seL4_Word batch = MIN(sent % MAX_BATCH + 1, ITEMS - sent);
+        for (seL4_Word i = 0; i < batch; i++) {
+            items[i] = (sent + i) * PRODUCERS + id;
+        }
+        size_t done = 0;
+        while (done < batch) {
+            size_t n = ntfn_ring_enqueue(ring, &items[done], batch - done, ntfn);
+            if (n == 0) {
+                seL4_Yield();
+            }
+            done += n;
+        }
+        sent += batch;
+    }
+    return NULL;
+}
+
+/* producers enqueuing at once lose no item, and the items of each stay in order */
+static void producers_in_order(void)
+{
+    seL4_BootInfo *info = boot();
+    pthread_t threads[PRODUCERS];
+    seL4_Word next[PRODUCERS] = {0};
+    seL4_Word items[MAX_BATCH * 2];
+
+    ntfn = alloc_object(info, seL4_NotificationObject, 0);
+    ring = ntfn_ring_init(buf, sizeof(buf), sizeof(seL4_Word));
+    CHECK(ring->size == 64);
+    for (seL4_Word i = 0; i < PRODUCERS; i++) {
+        pthread_create(&threads[i], NULL, producer, (void *) i);
+    }
+    for (seL4_Word received = 0; received < PRODUCERS * ITEMS;) {
+        size_t n = ntfn_ring_dequeue_wait(ring, items, ARRAY_SIZE(items), ntfn);
+        for (size_t i = 0; i < n; i++) {
+            seL4_Word id = items[i] % PRODUCERS;
+            CHECK(items[i] / PRODUCERS == next[id]);
+            next[id]++;
+        }
+        received += n;
+    }
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(next[i] == ITEMS);
+    }
+    CHECK(ntfn_ring_dequeue(ring, items, ARRAY_SIZE(items)) == 0);
+    /* every wait was woken by a signal, so none of them missed one */
+    CHECK(sim_counts.waits <= sim_counts.signals);
+}
+
+int main(int argc, char *argv[])
+{
+    const test_case_t cases[] = {
+        TEST_CASE(items_wrap),
+        TEST_CASE(producers_in_order),
+    };
+    return test_main(cases, ARRAY_SIZE(cases), argc, argv);
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <timer_driver/driver.h>
+#include "sim_ttc.h"
+#include "test.h"
+
+#define DEADLINE_TIMER 0
+#define CLOCK_TIMER 1
+/* the longest hardware timeout of timer_set_deadline, DEADLINE_SEGMENT_MAX_NS in driver.c */
+#define SEGMENT_MAX_NS ((0xffffull << 15) * NS_IN_S / SIM_TTC_FREQ / 2)
+
+static sim_ttc_t ttc;
+
+static uint64_t rnd(void)
+{
+    static uint64_t x = 88172645463325252ull;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+}
+
+/* the time the clock should read: the counts of its timer so far, in ns rounded down */
+static uint64_t clock_truth(int prescale)
+{
+    unsigned __int128 counts = ttc.cycles >> prescale;
+    return counts * ((unsigned __int128) NS_IN_S << prescale) / SIM_TTC_FREQ;
+}
+
+/* the clock never goes backwards, and is never more than a ns behind the counts of its timer,
+   at every prescale and however late its interrupts are handled within half a wrap */
+static void clock_prescales(void)
+{
+    for (int prescale = 0; prescale <= 16; prescale++) {
+        timer_clock_t clock;
+        sim_ttc_init(&ttc);
+        CHECK(timer_clock_init(&clock, CLOCK_TIMER, ttc.regs, prescale) == 0);
+        sim_ttc_sync(&ttc);
+        CHECK(sim_ttc_prescale(&ttc, CLOCK_TIMER) == prescale);
+
+        const uint64_t wrap = BIT(16) << prescale;
+        uint64_t last = 0;
+        for (int irq = 0; irq < 10000; irq++) {
+            uint64_t next = sim_ttc_next_irq(&ttc, CLOCK_TIMER);
+            /* halfway through the wrap and at its end */
+            CHECK(next <= wrap / 2);
+            /* the interrupt is handled up to a quarter of a wrap after it, with the time read
+               a few times in between */
+            uint64_t until = next + (rnd() % 4 == 0 ? rnd() % (wrap / 4) : rnd() % 1000);
+            while (until > 0) {
+                uint64_t step = rnd() % (wrap / 8) + 1;
+                step = MIN(step, until);
+                sim_ttc_advance(&ttc, step);
+                until -= step;
+                uint64_t now = timer_get_time(&clock);
+                uint64_t truth = clock_truth(prescale);
+                CHECK(now >= last);
+                CHECK(now <= truth && truth - now <= 1);
+                last = now;
+            }
+            CHECK(timer_clock_handle_irq(&clock) == 0);
+            sim_ttc_sync(&ttc);
+            CHECK(timer_get_time(&clock) >= last);
+        }
+        /* 5000 wraps went by */
+        CHECK(last >= 5000 * (wrap * NS_IN_S / SIM_TTC_FREQ));
+    }
+}
+
+/* the real time in ns, which the clock trails by less than one of its counts */
+static uint64_t true_ns(void)
+{
+    return (unsigned __int128) ttc.cycles * NS_IN_S / SIM_TTC_FREQ;
+}
+
+/*
+ * Handle the next interrupt, of the clock or of the deadline timer, each a random latency after
+ * it is raised. One raised while the clock's is being handled is handled straight after it.
+ *
+ * @param raised set to the time the deadline timer's interrupt was raised, if it was
+ * @return what timer_handle_deadline_irq returned, or 0 if only the clock's was handled
+ */
+static int next_irq(timer_clock_t *clock, timer_drv_t *timer_drv, uint64_t *raised, int *hardware_timeouts)
+{
+    uint64_t clock_irq = sim_ttc_next_irq(&ttc, CLOCK_TIMER);
+    uint64_t deadline_irq = sim_ttc_next_irq(&ttc, DEADLINE_TIMER);
+    CHECK(deadline_irq != UINT64_MAX);
+    if (clock_irq <= deadline_irq) {
+        uint64_t latency = rnd() % 2000;
+        if (clock_irq + latency < deadline_irq) {
+            sim_ttc_advance(&ttc, clock_irq + latency);
+            CHECK(timer_clock_handle_irq(clock) == 0);
+            sim_ttc_sync(&ttc);
+            return 0;
+        }
+        sim_ttc_advance(&ttc, deadline_irq);
+        *raised = true_ns();
+        sim_ttc_advance(&ttc, clock_irq + latency - deadline_irq);
+        CHECK(timer_clock_handle_irq(clock) == 0);
+        sim_ttc_sync(&ttc);
+    } else {
+        sim_ttc_advance(&ttc, deadline_irq);
+        *raised = true_ns();
+        sim_ttc_advance(&ttc, rnd() % 500);
+    }
+    (*hardware_timeouts)++;
+    int reached = timer_handle_deadline_irq(timer_drv);
+    sim_ttc_sync(&ttc);
+    return reached;
+}
+
+/* a deadline any distance away is reached with a chain of hardware timeouts, one more than the
+   longest ones it takes to get there, and the last ends less than 2 us after it however late the
+   interrupts are handled: the shortest hardware timeout is 1 us, and the clock trails by up to
+   one of its counts, 577 ns at a prescale of 6 */
+static void deadline_chaining(void)
+{
+    const uint64_t timeouts[] = {
+        1000, 5000, 123456, 590000, NS_IN_MS, 9 * NS_IN_S, 20 * NS_IN_S, 600 * NS_IN_S,
+        3600 * NS_IN_S, 7200 * NS_IN_S,
+    };
+    timer_clock_t clock;
+    timer_drv_t timer_drv;
+    sim_ttc_init(&ttc);
+    CHECK(timer_clock_init(&clock, CLOCK_TIMER, ttc.regs, 6) == 0);
+    CHECK(timer_init(&timer_drv, DEADLINE_TIMER, ttc.regs) == 0);
+    sim_ttc_sync(&ttc);
+
+    for (int i = 0; i < ARRAY_SIZE(timeouts); i++) {
+        uint64_t deadline = timer_get_time(&clock) + timeouts[i];
+        int reached = timer_set_deadline(&timer_drv, &clock, deadline);
+        sim_ttc_sync(&ttc);
+        int hardware_timeouts = 0;
+        uint64_t raised = 0;
+        while (reached == 0) {
+            reached = next_irq(&clock, &timer_drv, &raised, &hardware_timeouts);
+        }
+        CHECK(reached == 1);
+        CHECK(timer_get_time(&clock) >= deadline);
+        CHECK(hardware_timeouts <= DIV_ROUND_UP(timeouts[i], SEGMENT_MAX_NS) + 1);
+        CHECK((int64_t) (raised - deadline) < 2000);
+        printf("%14llu ns: %d hardware timeouts, the last ending %+lld ns from the deadline\n", (unsigned long long) timeouts[i],
+               hardware_timeouts, (long long) (raised - deadline));
+    }
+}
+
+/* the prescale search of timer_set_timeout before it had a table of prescales, with two divides */
+static int divide_prescale(uint64_t ns, uint64_t *interval)
+{
+    uint64_t required_freq = freq_cycles_and_ns_to_hz(0xffff, ns);
+    int prescale;
+    uint64_t curr_freq = SIM_TTC_FREQ;
+    for (prescale = 0; curr_freq > required_freq; prescale++, curr_freq >>= 1);
+    if (prescale > 15) {
+        return -1;
+    }
+    *interval = freq_ns_and_hz_to_cycles(ns, curr_freq);
+    return prescale;
+}
+
+/* over 20M random timeouts up to 34 s, timer_set_timeout picks the same prescale as the divides
+   did, or fails where they did, and counts at most one cycle less */
+static void prescale_matches_divide(void)
+{
+    timer_drv_t timer_drv;
+    sim_ttc_init(&ttc);
+    CHECK(timer_init(&timer_drv, DEADLINE_TIMER, ttc.regs) == 0);
+    sim_ttc_sync(&ttc);
+
+    int failed = 0;
+    for (int i = 0; i < 20000000; i++) {
+        /* spread evenly over the orders of magnitude */
+        uint64_t r = rnd();
+        uint64_t ns = (r >> 29) % BIT(r % 35 + 1) + 1;
+        uint64_t expected_interval;
+        int expected = divide_prescale(ns, &expected_interval);
+        int error = timer_set_timeout(&timer_drv, ns, false);
+        sim_ttc_sync(&ttc);
+        if (expected < 0) {
+            CHECK(error == -1);
+            failed++;
+            continue;
+        }
+        CHECK(error == 0);
+        CHECK(sim_ttc_prescale(&ttc, DEADLINE_TIMER) == expected);
+        uint64_t match = ttc.regs[0x30 / 4 + DEADLINE_TIMER];
+        uint64_t interval = (match - sim_ttc_count(&ttc, DEADLINE_TIMER)) & 0xffff;
+        CHECK(interval == expected_interval || interval + 1 == expected_interval);
+    }
+    /* the longest timeout is about 19 s */
+    CHECK(failed > 0);
+}
+
+int main(int argc, char *argv[])
+{
+    const test_case_t cases[] = {
+        TEST_CASE(clock_prescales),
+        TEST_CASE(deadline_chaining),
+        TEST_CASE(prescale_matches_divide),
+    };
+    return test_main(cases, ARRAY_SIZE(cases), argc, argv);
+}
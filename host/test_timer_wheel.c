@@ -0,0 +1,159 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <timer_driver/timer_wheel.h>
+#include "test.h"
+
+#define ENTRIES 100000
+
+static timer_wheel_t wheel;
+static timer_wheel_entry_t entries[ENTRIES];
+/* what the wheel should hold: whether each entry is pending and its deadline */
+static bool pending[ENTRIES];
+static uint64_t deadlines[ENTRIES];
+static uint64_t now;
+/* calls to timer_wheel_handle_irq so far, and the time of the last one */
+static size_t handled;
+static uint64_t last_handled;
+/* the value of handled when each entry was inserted */
+static size_t inserted_in[ENTRIES];
+static size_t fired;
+
+static uint64_t rnd(void)
+{
+    static uint64_t x = 88172645463325252ull;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+}
+
+/* a deadline a random distance away, in ranges from ns up to the end of time */
+static uint64_t random_deadline(void)
+{
+    const uint64_t ranges[] = { 1000, NS_IN_MS, NS_IN_S * 100, BIT(62) };
+    uint64_t r = rnd();
+    if (r % 17 == 0) {
+        /* already passed */
+        return now - MIN(now, r % 1000);
+    }
+    return now + r % ranges[r % ARRAY_SIZE(ranges)];
+}
+
+/* each timeout must fire once, in the first call that finds it due */
+static void expired(timer_wheel_entry_t *entry, void *cookie)
+{
+    size_t i = entry - entries;
+    CHECK(pending[i]);
+    CHECK(deadlines[i] <= now);
+    /* not late: it was not yet due at the previous call, or was inserted since */
+    CHECK(deadlines[i] > last_handled || inserted_in[i] == handled - 1);
+    pending[i] = false;
+    fired++;
+}
+
+static void insert(size_t i)
+{
+    deadlines[i] = random_deadline();
+    pending[i] = true;
+    inserted_in[i] = handled;
+    CHECK(timer_wheel_insert(&wheel, &entries[i], deadlines[i], expired, NULL, now) == 0);
+}
+
+/* 100k random deadlines, with random cancellations and insertions while they expire */
+static void random_deadlines(void)
+{
+    now = 1000;
+    last_handled = now;
+    timer_wheel_init(&wheel, NULL, now);
+    for (size_t i = 0; i < ENTRIES; i++) {
+        insert(i);
+    }
+    size_t cancelled = 0;
+    size_t reinserted = 0;
+    for (size_t i = 0; i < ENTRIES; i += 7) {
+        CHECK(timer_wheel_cancel(&wheel, &entries[i]) == 0);
+        pending[i] = false;
+        cancelled++;
+    }
+
+    uint64_t previous = 0;
+    while (true) {
+        uint64_t next = timer_wheel_next_deadline(&wheel);
+        if (next == UINT64_MAX) {
+            break;
+        }
+        CHECK(next >= previous);
+        previous = next;
+
+        /* the interrupt comes at the next deadline, or sometimes a little after it */
+        uint64_t late = rnd() % 3 == 0 ? rnd() % 5000 : 0;
+        now = MAX(now, next + MIN(late, UINT64_MAX - next));
+        handled++;
+        CHECK(timer_wheel_handle_irq(&wheel, now) >= 0);
+        last_handled = now;
+        CHECK(timer_wheel_next_deadline(&wheel) > now);
+
+        /* change some of the timeouts that are left */
+        size_t i = rnd() % ENTRIES;
+        if (pending[i] && rnd() % 2) {
+            timer_wheel_cancel(&wheel, &entries[i]);
+            pending[i] = false;
+            cancelled++;
+        } else if (!pending[i] && reinserted < ENTRIES / 10 && now < BIT(62)) {
+            insert(i);
+            reinserted++;
+        }
+    }
+
+    CHECK(fired + cancelled == ENTRIES + reinserted);
+    for (size_t i = 0; i < ENTRIES; i++) {
+        CHECK(!pending[i] && entries[i].pprev == NULL);
+    }
+}
+
+static int cancel_calls[8];
+
+/* the callback of each timeout cancels all the others */
+static void cancel_others(timer_wheel_entry_t *entry, void *cookie)
+{
+    cancel_calls[entry - entries]++;
+    for (int j = 0; j < ARRAY_SIZE(cancel_calls); j++) {
+        timer_wheel_cancel(&wheel, &entries[j]);
+    }
+}
+
+/* a callback can cancel timeouts that expired at the same time, which are then not called */
+static void cancel_in_callback(void)
+{
+    now = 10;
+    timer_wheel_init(&wheel, NULL, now);
+    for (int i = 0; i < 6; i++) {
+        timer_wheel_insert(&wheel, &entries[i], 20 + i * 7, cancel_others, NULL, now);
+    }
+    /* one that is already due, and one that is not due yet */
+    timer_wheel_insert(&wheel, &entries[6], 5, cancel_others, NULL, now);
+    timer_wheel_insert(&wheel, &entries[7], 1000, cancel_others, NULL, now);
+
+    now = 100;
+    CHECK(timer_wheel_handle_irq(&wheel, now) == 1);
+    int calls = 0;
+    for (int i = 0; i < ARRAY_SIZE(cancel_calls); i++) {
+        calls += cancel_calls[i];
+    }
+    CHECK(calls == 1 && cancel_calls[7] == 0);
+    /* the one that was not due was cancelled too */
+    CHECK(timer_wheel_next_deadline(&wheel) == UINT64_MAX);
+}
+
+int main(int argc, char *argv[])
+{
+    const test_case_t cases[] = {
+        TEST_CASE(random_deadlines),
+        TEST_CASE(cancel_in_callback),
+    };
+    return test_main(cases, ARRAY_SIZE(cases), argc, argv);
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <string.h>
+#include <utils/util.h>
+#include "sim_ttc.h"
+
+/* the registers of timer 0, those of timers 1 and 2 follow each one */
+#define CLK_CTRL 0x00
+#define CNT_CTRL 0x0C
+#define CNT_VAL 0x18
+#define INTERVAL 0x24
+#define MATCH0 0x30
+#define INT_STS 0x54
+#define INT_EN 0x60
+
+#define CLK_CTRL_PRESCALE_ENABLE (1u << 0)
+#define CNT_CTRL_STOP (1u << 0)
+#define CNT_CTRL_INT (1u << 1)
+#define CNT_CTRL_MATCH (1u << 3)
+#define CNT_CTRL_RST (1u << 4)
+/* the bits of both the interrupt enable and status registers */
+#define INT_INTERVAL (1u << 0)
+#define INT_MATCH0 (1u << 1)
+#define INT_OVERFLOW (1u << 4)
+
+#define COUNTER_RANGE (1ull << 16)
+
+static uint32_t *reg(sim_ttc_t *ttc, int offset, int timer)
+{
+    return &ttc->regs[offset / 4 + timer];
+}
+
+/* the counter goes back to 0 after it reaches its interval in interval mode, or after 16 bits */
+static uint64_t period(sim_ttc_t *ttc, int timer)
+{
+    if (*reg(ttc, CNT_CTRL, timer) & CNT_CTRL_INT) {
+        return (*reg(ttc, INTERVAL, timer) & (COUNTER_RANGE - 1)) + 1;
+    }
+    return COUNTER_RANGE;
+}
+
+/* a counter past a new, lower interval is taken to wrap at the next count */
+static uint64_t count_in_period(sim_ttc_t *ttc, int timer)
+{
+    return MIN(sim_ttc_count(ttc, timer), period(ttc, timer) - 1);
+}
+
+/* the interrupt status bit set when the counter goes back to 0 */
+static uint32_t wrap_irq(sim_ttc_t *ttc, int timer)
+{
+    return *reg(ttc, CNT_CTRL, timer) & CNT_CTRL_INT ? INT_INTERVAL : INT_OVERFLOW;
+}
+
+/* the counts until the match register matches, or 0 if it never will */
+static uint64_t counts_to_match(sim_ttc_t *ttc, int timer)
+{
+    uint64_t match = *reg(ttc, MATCH0, timer) & (COUNTER_RANGE - 1);
+    uint64_t p = period(ttc, timer);
+    if (!(*reg(ttc, CNT_CTRL, timer) & CNT_CTRL_MATCH) || match >= p) {
+        return 0;
+    }
+    uint64_t counts = (match + p - count_in_period(ttc, timer)) % p;
+    /* the counter is at the match value already, which only matches when it gets there again */
+    return counts == 0 ? p : counts;
+}
+
+void sim_ttc_init(sim_ttc_t *ttc)
+{
+    memset(ttc, 0, sizeof(*ttc));
+}
+
+void sim_ttc_sync(sim_ttc_t *ttc)
+{
+    for (int timer = 0; timer < SIM_TTC_TIMERS; timer++) {
+        uint32_t *cnt_ctrl = reg(ttc, CNT_CTRL, timer);
+        if (*cnt_ctrl & CNT_CTRL_RST) {
+            *reg(ttc, CNT_VAL, timer) = 0;
+            ttc->residue[timer] = 0;
+            *cnt_ctrl &= ~CNT_CTRL_RST;
+        }
+        /* the prescaler starts again when it is changed */
+        int prescale = sim_ttc_prescale(ttc, timer);
+        if (prescale != ttc->prescale[timer]) {
+            ttc->prescale[timer] = prescale;
+            ttc->residue[timer] = 0;
+        }
+    }
+}
+
+void sim_ttc_advance(sim_ttc_t *ttc, uint64_t cycles)
+{
+    ttc->cycles += cycles;
+    for (int timer = 0; timer < SIM_TTC_TIMERS; timer++) {
+        if (*reg(ttc, CNT_CTRL, timer) & CNT_CTRL_STOP) {
+            continue;
+        }
+        int prescale = ttc->prescale[timer];
+        uint64_t total = ttc->residue[timer] + cycles;
+        uint64_t counts = total >> prescale;
+        ttc->residue[timer] = total & ((1ull << prescale) - 1);
+
+        uint32_t enabled = *reg(ttc, INT_EN, timer);
+        uint32_t *status = reg(ttc, INT_STS, timer);
+        uint64_t p = period(ttc, timer);
+        uint64_t count = count_in_period(ttc, timer);
+        if (counts >= p - count) {
+            *status |= wrap_irq(ttc, timer) & enabled;
+        }
+        uint64_t to_match = counts_to_match(ttc, timer);
+        if (to_match != 0 && counts >= to_match) {
+            *status |= INT_MATCH0 & enabled;
+        }
+        *reg(ttc, CNT_VAL, timer) = (count + counts % p) % p;
+    }
+}
+
+uint64_t sim_ttc_next_irq(sim_ttc_t *ttc, int timer)
+{
+    if (*reg(ttc, CNT_CTRL, timer) & CNT_CTRL_STOP) {
+        return UINT64_MAX;
+    }
+    uint32_t enabled = *reg(ttc, INT_EN, timer);
+    uint64_t counts = UINT64_MAX;
+    if (enabled & wrap_irq(ttc, timer)) {
+        counts = period(ttc, timer) - count_in_period(ttc, timer);
+    }
+    uint64_t to_match = counts_to_match(ttc, timer);
+    if ((enabled & INT_MATCH0) && to_match != 0 && to_match < counts) {
+        counts = to_match;
+    }
+    if (counts == UINT64_MAX) {
+        return UINT64_MAX;
+    }
+    return (counts << ttc->prescale[timer]) - ttc->residue[timer];
+}
+
+uint32_t sim_ttc_count(sim_ttc_t *ttc, int timer)
+{
+    return *reg(ttc, CNT_VAL, timer);
+}
+
+int sim_ttc_prescale(sim_ttc_t *ttc, int timer)
+{
+    uint32_t clk_ctrl = *reg(ttc, CLK_CTRL, timer);
+    if (!(clk_ctrl & CLK_CTRL_PRESCALE_ENABLE)) {
+        return 0;
+    }
+    return ((clk_ctrl >> 1) & 0xf) + 1;
+}
@@ -4,25 +4,182 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-/* A very simple, inefficient, non-freeing allocator for doing the tutorials */
+#pragma once
+
+#include <sel4/sel4.h>
+#include <sel4tutorials/gen_config.h>
+
+/* A very simple allocator for doing the tutorials. It only frees objects if
+ * LibSel4TutorialsAllocReclaim is set. */
+
+/* How alloc_object picks between untypeds that have room for an object */
+typedef enum {
+    /* use the first untyped in the bootinfo list with enough room */
+    ALLOC_FIRST_FIT,
+    /* use the untyped that would have the least room left over */
+    ALLOC_BEST_FIT,
+} alloc_fit_policy_t;
 
 /*
- * Allocate a slot from boot info. Allocates slots from info->empty.start.
+ * Allocate a slot from boot info. Reuses the lowest slot freed with free_slot if there is
+ * one, and otherwise allocates slots from info->empty.start.
  * This will not work if slots in the bootinfo empty range have already been used.
  *
- * @return a cslot that has not already been returned by this function, from the range
- *         specified in info->empty
+ * @return a cslot that is not currently allocated, from the range specified in info->empty
  */
 seL4_CPtr alloc_slot(seL4_BootInfo *info);
 
+/*
+ * Allocate count consecutive slots, as needed for the destination of a retype that creates
+ * several objects. Takes them from info->empty.start if there is room, and otherwise from the
+ * lowest run of slots freed with free_slot.
+ *
+ * @return the first cslot of the range
+ */
+seL4_CPtr alloc_slot_range(seL4_BootInfo *info, seL4_Word count);
+
+/*
+ * Delete the cap in a slot of the root CNode and return the slot to alloc_slot.
+ *
+ * @param slot a cslot returned by alloc_slot or alloc_slot_range. Objects created with the
+ *        reclaiming allocator should be freed with free_object instead.
+ */
+void free_slot(seL4_CPtr slot);
+
 /*
  * Create an object of the desired type and size.
  *
- * This function iterates through the info->untyped capability range, attempting to
- * retype into an object of the provided type and size, until a successful allocation is made.
+ * This function keeps a model of how much of each untyped in the info->untyped capability
+ * range has been used, and retypes from an untyped the model says has room for an object of
+ * the provided type and size. This will not work if the untypeds have already been retyped
+ * by something else.
+ *
+ * Variably sized objects are placed in the model at the alignment of their size, so a large
+ * object is never placed in an untyped that only has room for it before alignment.
  *
  * @param type of the object to create
- * @param size of the object to create. Unused if the object is not variably sized.
+ * @param size_bits log2 size of the object to create: the number of slots for a CNode, or the
+ *        number of bytes for an untyped or scheduling context. Unused if the object is not
+ *        variably sized. It is a fatal error to pass a size the kernel would reject.
  * @return a cslot containing the newly created untyped.
  */
-seL4_CPtr alloc_object(seL4_BootInfo *info, seL4_Word type, seL4_Word size_bits);
\ No newline at end of file
+seL4_CPtr alloc_object(seL4_BootInfo *info, seL4_Word type, seL4_Word size_bits);
+
+/*
+ * Create count objects of the desired type and size in a contiguous range of cslots.
+ *
+ * Each seL4_Untyped_Retype creates as many of the objects as the chosen untyped has room
+ * for, so the number of retypes is usually far smaller than count. The objects are split
+ * across as many untypeds as needed.
+ *
+ * @param type of the objects to create
+ * @param size_bits log2 size of the objects to create, as for alloc_object
+ * @param count number of objects to create
+ * @param out_slots array of count cslots that is filled in with the new objects, in order,
+ *        or NULL. The slots are consecutive from the returned slot.
+ * @return the cslot of the first object
+ */
+seL4_CPtr alloc_objects(seL4_BootInfo *info, seL4_Word type, seL4_Word size_bits, seL4_Word count,
+                        seL4_CPtr *out_slots);
+
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_RECLAIM
+/*
+ * Free an object created by alloc_object or alloc_objects by deleting its cap.
+ *
+ * Objects are grouped into arenas by the untyped they were retyped from. The memory of an
+ * object is only reused once every object in its arena has been freed, at which point the
+ * untyped is revoked, deleting any caps that were derived from the arena's objects.
+ *
+ * The slot is returned to alloc_slot.
+ *
+ * @param cslot a cslot returned by alloc_object or alloc_objects that has not yet been freed
+ */
+void free_object(seL4_BootInfo *info, seL4_CPtr cslot);
+#endif
+
+/*
+ * Create a frame for the device memory at a physical address, such as the registers of a device.
+ *
+ * The device untypeds from bootinfo are kept in a table sorted by physical address, which is
+ * binary searched for the one covering paddr. That untyped is split in half repeatedly, each
+ * time keeping the half that contains paddr, until it is the size of the frame. The halves that
+ * are split off go back into the table for later device frames. This will not work if the
+ * device untypeds in bootinfo have already been retyped by something else.
+ *
+ * @param paddr physical address of the frame, aligned to its size
+ * @param size_bits size of the frame, which must be a frame size of the architecture
+ * @return a cslot containing the new frame, or seL4_CapNull if the table has no room for the
+ *         halves that splitting the untyped would add
+ */
+seL4_CPtr alloc_device_frame(seL4_BootInfo *info, seL4_Word paddr, seL4_Word size_bits);
+
+/*
+ * Select how alloc_object picks an untyped. The default is ALLOC_FIRST_FIT.
+ */
+void alloc_set_fit_policy(alloc_fit_policy_t policy);
+
+/*
+ * Return the log2 size in bytes of an object of the given type and size, which is also its
+ * alignment in an untyped.
+ *
+ * @return the size in bits, or 0 if the size of the type is not known.
+ */
+seL4_Word alloc_object_size_bits(seL4_Word type, seL4_Word size_bits);
+
+/*
+ * Return the frame object type of the architecture with the given size. It is a fatal error if
+ * there is none.
+ */
+seL4_Word alloc_frame_type(seL4_Word size_bits);
+
+/*
+ * Return how many objects of the desired type and size the untypeds still have room for.
+ *
+ * This is worked out from the allocator's own record of each untyped, so it is only accurate
+ * for objects whose size the allocator knows, and is zero for the others. It lets a caller
+ * check that a batch will fit before committing to it, for example to fall back to smaller
+ * frames when no untyped is large enough for a large one.
+ *
+ * @param type of the objects
+ * @param size_bits log2 size of the objects, as for alloc_object
+ */
+seL4_Word alloc_object_capacity(seL4_BootInfo *info, seL4_Word type, seL4_Word size_bits);
+
+/*
+ * Retype count objects of the given type and size from untyped into consecutive slots of the
+ * root CNode starting at first.
+ *
+ * Every retype made by this library, including alloc_device and alloc_mt, goes through here so
+ * that alloc_retype_count and the statistics see all of them. Code outside the library that
+ * retypes untypeds it got from the allocator should use it for the same reason.
+ */
+seL4_Error alloc_retype(seL4_CPtr untyped, seL4_Word type, seL4_Word size_bits, seL4_CPtr first, seL4_Word count);
+
+/*
+ * Delete or revoke the cap in a slot of the root CNode.
+ *
+ * Together with alloc_retype these are the only kernel invocations the allocator makes, so a
+ * stub kernel that implements the three is enough to run it off target, as the tests in host/ do.
+ */
+seL4_Error alloc_delete(seL4_CPtr slot);
+seL4_Error alloc_revoke(seL4_CPtr slot);
+
+/*
+ * Return the number of seL4_Untyped_Retype invocations made through alloc_retype so far.
+ *
+ * Sampling this before and after a run of allocations gives the average number of
+ * retype syscalls each allocation needed, which should be close to one.
+ */
+seL4_Word alloc_retype_count(void);
+
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_STATS
+/*
+ * Print the statistics kept by alloc_object, alloc_objects and alloc_slot with
+ * kernel_putchar_write: the retypes made and how many failed, slot use and its peak,
+ * the number of objects created of each type, and for each untyped that has been used how
+ * many bytes were used, lost to alignment padding, and are still free.
+ *
+ * Only available if LibSel4TutorialsAllocStats is set.
+ */
+void alloc_stats_dump(seL4_BootInfo *info);
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <sel4/sel4.h>
+
+/*
+ * A non-freeing allocator that can be used by several threads sharing the root CNode at once,
+ * without a lock.
+ *
+ * alloc_mt_init sets aside a range of slots and a set of untyped pools using the single threaded
+ * allocator. Slots are then handed out from the range with an atomic fetch-add. Each thread
+ * claims whole pools for itself, again with an atomic fetch-add, so only the claiming thread
+ * ever retypes from a pool and its watermark needs no synchronisation. Fixed size objects are
+ * retyped several at a time into a per-thread magazine.
+ *
+ * The single threaded allocator in alloc.h must not be used while other threads are using
+ * this one.
+ */
+
+#define ALLOC_MT_MAGAZINE_SIZE 16
+
+typedef struct alloc_mt_magazine {
+    seL4_CPtr objects[ALLOC_MT_MAGAZINE_SIZE];
+    seL4_Word count;
+} alloc_mt_magazine_t;
+
+/* Allocation state owned by a single thread */
+typedef struct alloc_mt_thread {
+    /* the pool this thread is retyping from, or ALLOC_MT_NO_POOL */
+    seL4_Word pool;
+    /* watermark of the pool in bytes */
+    seL4_Word watermark;
+    alloc_mt_magazine_t magazines[seL4_ObjectTypeCount];
+} alloc_mt_thread_t;
+
+#define ALLOC_MT_NO_POOL ((seL4_Word) -1)
+
+/*
+ * Set up the multi-threaded allocator. Must be called once, before any other thread uses it.
+ *
+ * @param num_slots number of slots to set aside for alloc_mt_slot and alloc_mt_object
+ * @param num_pools number of untyped pools to create
+ * @param pool_size_bits size of each untyped pool
+ */
+void alloc_mt_init(seL4_BootInfo *info, seL4_Word num_slots, seL4_Word num_pools, seL4_Word pool_size_bits);
+
+/*
+ * Initialise the allocation state of a thread. The state must only be used by one thread.
+ */
+void alloc_mt_thread_init(alloc_mt_thread_t *thread);
+
+/*
+ * Allocate an empty slot. Safe to call from any thread.
+ *
+ * @return a cslot that has not been returned by alloc_mt_slot before
+ */
+seL4_CPtr alloc_mt_slot(void);
+
+/*
+ * Create an object of the desired type and size from the calling thread's pool.
+ *
+ * @param thread the allocation state of the calling thread
+ * @param type of the object to create
+ * @param size_bits of the object to create, as for alloc_object
+ * @return a cslot containing the new object
+ */
+seL4_CPtr alloc_mt_object(alloc_mt_thread_t *thread, seL4_Word type, seL4_Word size_bits);
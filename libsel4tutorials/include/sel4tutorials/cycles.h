@@ -0,0 +1,155 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <autoconf.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Cycle counter timing for benchmarks.
+ *
+ * On x86 the counter is the TSC. On aarch32 it is the 32-bit PMU cycle counter, which can only
+ * be used from user level if the kernel is built with KernelArmExportPMUUser, must be started
+ * with cycles_init, and wraps every few seconds, so only short intervals can be measured.
+ * Without a counter the readers return 0.
+ *
+ * A typical measurement is:
+ *
+ *     cycles_init();
+ *     uint64_t overhead = cycles_overhead();
+ *     cycles_stats_init(&stats, samples, ARRAY_SIZE(samples), overhead);
+ *     for (...) {
+ *         uint64_t start = cycles_read();
+ *         ...
+ *         cycles_stats_add(&stats, cycles_elapsed(start, cycles_read_ordered()));
+ *     }
+ *     cycles_stats_summarise(&stats, &summary);
+ */
+
+/* Read the cycle counter. The read may happen before earlier instructions have finished. */
+static inline uint64_t cycles_read(void)
+{
+#if defined(CONFIG_ARCH_X86)
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t) high << 32) | low;
+#elif defined(CONFIG_ARCH_AARCH32) && defined(CONFIG_EXPORT_PMU_USER)
+    uint32_t count;
+    asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r"(count));
+    return count;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Read the cycle counter once all earlier instructions have finished, for the end of a
+ * measurement. On x86 this is lfence before rdtsc rather than rdtscp, as not every CPU or
+ * emulated CPU model has rdtscp, while lfence comes with SSE2.
+ */
+static inline uint64_t cycles_read_ordered(void)
+{
+#if defined(CONFIG_ARCH_X86)
+    uint32_t low, high;
+    asm volatile("lfence\n"
+                 "rdtsc" : "=a"(low), "=d"(high) :: "memory");
+    return ((uint64_t) high << 32) | low;
+#elif defined(CONFIG_ARCH_AARCH32) && defined(CONFIG_EXPORT_PMU_USER)
+    uint32_t count;
+    asm volatile("isb\n"
+                 "mrc p15, 0, %0, c9, c13, 0" : "=r"(count) :: "memory");
+    return count;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * The cycles counted from start to end, both read with the readers above. The aarch32 counter
+ * is only 32 bits wide, so there the difference is taken modulo 2^32, which is right for any
+ * interval shorter than one wrap of the counter.
+ */
+static inline uint64_t cycles_elapsed(uint64_t start, uint64_t end)
+{
+#if defined(CONFIG_ARCH_AARCH32)
+    return (uint32_t)(end - start);
+#else
+    return end - start;
+#endif
+}
+
+/* Start the cycle counter if it needs starting. Only aarch32 does. */
+void cycles_init(void);
+
+/*
+ * Measure the cost of a cycles_read followed by a cycles_read_ordered, which is included in
+ * every measurement made with them.
+ *
+ * @return the smallest difference seen over a number of tries
+ */
+uint64_t cycles_overhead(void);
+
+/*
+ * Work out the frequency of the cycle counter by counting cycles across an interval of another
+ * clock, such as the Zynq TTC or the PC's timer.
+ *
+ * @param now_ns returns the time of the reference clock in nanoseconds
+ * @param cookie passed to now_ns
+ * @param interval_ns how long to count for. Longer is more accurate, but on aarch32 it must be
+ *        shorter than the time the counter takes to wrap.
+ * @return the counter frequency in cycles per microsecond, rounded to the nearest
+ */
+uint64_t cycles_calibrate(uint64_t (*now_ns)(void *cookie), void *cookie, uint64_t interval_ns);
+
+/*
+ * An accumulator for measurements. The samples are kept so that percentiles can be
+ * calculated.
+ */
+typedef struct cycles_stats {
+    uint64_t *samples;
+    size_t capacity;
+    size_t count;
+    /* samples that did not fit */
+    size_t dropped;
+    /* subtracted from each sample as it is added */
+    uint64_t overhead;
+} cycles_stats_t;
+
+typedef struct cycles_summary {
+    size_t count;
+    uint64_t min;
+    uint64_t median;
+    uint64_t p99;
+    uint64_t max;
+    uint64_t mean;
+} cycles_summary_t;
+
+/*
+ * @param samples array to keep up to capacity samples in
+ * @param overhead to subtract from each sample, such as from cycles_overhead, or 0
+ */
+void cycles_stats_init(cycles_stats_t *stats, uint64_t *samples, size_t capacity, uint64_t overhead);
+
+/* Add a sample, less the overhead. Samples that do not fit are dropped and counted. */
+static inline void cycles_stats_add(cycles_stats_t *stats, uint64_t cycles)
+{
+    if (stats->count == stats->capacity) {
+        stats->dropped++;
+        return;
+    }
+    stats->samples[stats->count++] = cycles > stats->overhead ? cycles - stats->overhead : 0;
+}
+
+/*
+ * Calculate the statistics of the samples so far. This sorts the samples in place. The
+ * summary is all zero if there are no samples.
+ */
+void cycles_stats_summarise(cycles_stats_t *stats, cycles_summary_t *summary);
+
+/* Print a summary on one line, preceded by name */
+void cycles_summary_print(const char *name, cycles_summary_t *summary);
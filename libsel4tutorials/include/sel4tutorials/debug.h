@@ -0,0 +1,28 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sel4/sel4.h>
+
+/*
+ * Write count bytes of data with seL4_DebugPutChar. This is what printf writes through.
+ * Does nothing if the kernel is not a debug build.
+ *
+ * If LibSel4TutorialsPutcharBuffer is set, the output is collected in a per-thread buffer that
+ * is written out when a newline is written, when the buffer is full, when fflush or
+ * kernel_putchar_flush is called, and for the initial thread at exit.
+ *
+ * @return count
+ */
+size_t kernel_putchar_write(void *data, size_t count);
+
+/* Write out anything the calling thread has buffered in kernel_putchar_write. */
+void kernel_putchar_flush(void);
+
+/* set a thread's name for debugging purposes */
+void name_thread(seL4_CPtr tcb, char *name);
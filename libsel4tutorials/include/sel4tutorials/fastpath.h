@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <autoconf.h>
+#include <sel4/sel4.h>
+
+/*
+ * Checked versions of seL4_Call and seL4_ReplyRecv that, in debug builds, count the calls that
+ * cannot take the kernel's IPC fastpath and record why, by call site. The counts are printed
+ * at exit, or by fastpath_dump. In release builds they are plain seL4_Call and seL4_ReplyRecv.
+ *
+ * Only what is visible at user level can be checked: caps in the message, the message length,
+ * and, for fastpath_call, the priority of the receiver if it has been given with
+ * fastpath_set_endpoint_priority. A call that passes the checks can still take the slowpath,
+ * for example if the server is not waiting yet.
+ */
+
+typedef enum {
+    /* the message carries caps */
+    FASTPATH_EXTRA_CAPS,
+    /* the message is longer than seL4_FastMessageRegisters */
+    FASTPATH_LONG_MESSAGE,
+    /* the receiver has a lower priority than the caller */
+    FASTPATH_LOW_PRIORITY,
+    FASTPATH_NUM_REASONS
+} fastpath_reason_t;
+
+#ifdef CONFIG_DEBUG_BUILD
+
+#define fastpath_call(ep, info) fastpath_check_call((ep), (info), __FILE__, __LINE__)
+#ifdef CONFIG_KERNEL_MCS
+#define fastpath_reply_recv(ep, info, sender, reply) \
+    fastpath_check_reply_recv((ep), (info), (sender), (reply), __FILE__, __LINE__)
+#else
+#define fastpath_reply_recv(ep, info, sender) \
+    fastpath_check_reply_recv((ep), (info), (sender), __FILE__, __LINE__)
+#endif
+
+seL4_MessageInfo_t fastpath_check_call(seL4_CPtr ep, seL4_MessageInfo_t info, const char *file, int line);
+#ifdef CONFIG_KERNEL_MCS
+seL4_MessageInfo_t fastpath_check_reply_recv(seL4_CPtr ep, seL4_MessageInfo_t info, seL4_Word *sender,
+                                             seL4_CPtr reply, const char *file, int line);
+#else
+seL4_MessageInfo_t fastpath_check_reply_recv(seL4_CPtr ep, seL4_MessageInfo_t info, seL4_Word *sender,
+                                             const char *file, int line);
+#endif
+
+/* Record the priority of the calling thread, for the priority check of fastpath_call. */
+void fastpath_set_priority(seL4_Word prio);
+
+/* Record the priority of the thread that receives on ep, for the priority check of fastpath_call. */
+void fastpath_set_endpoint_priority(seL4_CPtr ep, seL4_Word prio);
+
+/* Print the number of checked calls and, for each call site that missed the fastpath, why. */
+void fastpath_dump(void);
+
+#else
+
+#define fastpath_call(ep, info) seL4_Call((ep), (info))
+#define fastpath_reply_recv seL4_ReplyRecv
+
+static inline void fastpath_set_priority(seL4_Word prio) {}
+static inline void fastpath_set_endpoint_priority(seL4_CPtr ep, seL4_Word prio) {}
+static inline void fastpath_dump(void) {}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sel4/sel4.h>
+#include <sel4tutorials/ring.h>
+
+/*
+ * A single-producer, single-consumer ring buffer of log output in memory shared between the
+ * thread that logs and a thread or component that drains it. Writing to the log is a memcpy
+ * and needs no syscalls, so unlike kernel_putchar_write it also works in release images.
+ *
+ * When the ring is full, the output that does not fit is dropped and counted.
+ */
+
+/* the layout is that of ring_t with one byte items, and dropped counting the bytes dropped */
+typedef ring_t log_ring_t;
+
+/*
+ * Set up a ring in a buffer, such as a frame shared by the producer and consumer. Must be called
+ * once, before either side uses the ring. The other side can use the ring at the same address in
+ * its own mapping of the buffer.
+ *
+ * @param buf to put the ring in
+ * @param buf_size size of buf. The ring uses the largest power of 2 that fits after its header.
+ * @return the ring
+ */
+log_ring_t *log_ring_init(void *buf, size_t buf_size);
+
+/*
+ * Write to the ring. Only one thread may write to a ring.
+ *
+ * @return the number of bytes written. The rest were dropped.
+ */
+size_t log_ring_write(log_ring_t *ring, const void *data, size_t count);
+
+/*
+ * Read from the ring. Only one thread may read from a ring.
+ *
+ * @return the number of bytes read into data, at most count
+ */
+size_t log_ring_read(log_ring_t *ring, void *data, size_t count);
+
+/*
+ * Send printf output of the calling process to a ring instead of kernel_putchar_write.
+ *
+ * @param ring to write to. Only one thread of the process may print.
+ * @param ntfn notification to signal when the ring goes from empty to not empty, so a drain
+ *        thread can wait on it with log_ring_drain_wait. seL4_CapNull if the consumer polls.
+ */
+void log_ring_register_stdio(log_ring_t *ring, seL4_CPtr ntfn);
+
+/*
+ * Move everything currently in the ring to a write function, such as kernel_putchar_write.
+ * For use by the consumer.
+ *
+ * @return the number of bytes moved
+ */
+size_t log_ring_drain(log_ring_t *ring, size_t (*write)(void *data, size_t count));
+
+/*
+ * Move everything in the ring to a write function, waiting on ntfn until there is something
+ * if the ring is empty. For a drain thread, with the notification passed to
+ * log_ring_register_stdio.
+ *
+ * @return the number of bytes moved, at least one
+ */
+size_t log_ring_drain_wait(log_ring_t *ring, size_t (*write)(void *data, size_t count), seL4_CPtr ntfn);
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <sel4/sel4.h>
+
+/*
+ * Helpers for backing a range of virtual memory with frames, using the largest frames that the
+ * range allows: large pages (and huge pages if configured) on x86, and sections, super sections
+ * and large pages on ARM. Bigger frames mean fewer objects, fewer mappings and fewer TLB misses.
+ */
+
+/* a region is made of at most this many runs of same-sized frames */
+#define FRAME_REGION_MAX_RUNS 8
+
+/* count frames of size 2^frame_bits in consecutive slots from first, mapped from vaddr upwards */
+typedef struct frame_run {
+    seL4_Word vaddr;
+    seL4_Word frame_bits;
+    seL4_CPtr first;
+    seL4_Word count;
+} frame_run_t;
+
+typedef struct frame_region {
+    seL4_Word vaddr;
+    seL4_Word size;
+    seL4_Word num_runs;
+    frame_run_t runs[FRAME_REGION_MAX_RUNS];
+} frame_region_t;
+
+/*
+ * Create the frames to back size bytes of virtual memory from vaddr.
+ *
+ * At each address the largest frame that is aligned there, fits in the rest of the region and
+ * fits in one of the untypeds is used, so a region that is aligned to a large frame size is
+ * backed with large frames while the untypeds have room for them, and with smaller frames after
+ * that. The frames are created with alloc_objects, one run of same-sized frames at a time.
+ *
+ * @param vaddr start of the region, aligned to seL4_PageBits
+ * @param size of the region, a multiple of the page size
+ * @param region filled in with the frames that were created
+ * @return seL4_RangeError if the region would need more than FRAME_REGION_MAX_RUNS runs, in
+ *         which case no frames are left allocated, and seL4_NoError otherwise
+ */
+seL4_Error alloc_frame_region(seL4_BootInfo *info, seL4_Word vaddr, seL4_Word size, frame_region_t *region);
+
+/*
+ * Map the frames of a region created by alloc_frame_region into a VSpace.
+ *
+ * Each run of frames is mapped as by map_region, so the missing paging structures are created
+ * at most once for the region, in one batch per type.
+ *
+ * @param vspace to map the region into
+ * @param rights of the mappings
+ * @param attrs architecture VM attributes of the mappings, such as seL4_X86_Default_VMAttributes
+ */
+void map_frame_region(seL4_BootInfo *info, seL4_CPtr vspace, frame_region_t *region, seL4_CapRights_t rights,
+                      seL4_Word attrs);
+
+/*
+ * Map n page sized frames at consecutive addresses from vaddr into a VSpace.
+ *
+ * The paging structures the region is missing are worked out up front, by mapping the first frame
+ * under each lowest level paging structure the region needs and looking at which level the
+ * lookup failed. The missing structures of each type are then created with a single
+ * alloc_objects call and mapped, and the remaining frames are mapped without any failures.
+ *
+ * @param vspace to map the frames into
+ * @param vaddr of the first frame, aligned to seL4_PageBits
+ * @param frames array of n frame caps of size seL4_PageBits
+ * @param n number of frames
+ * @param rights of the mappings
+ * @param attrs architecture VM attributes of the mappings, such as seL4_X86_Default_VMAttributes
+ */
+void map_region(seL4_BootInfo *info, seL4_CPtr vspace, seL4_Word vaddr, const seL4_CPtr *frames, seL4_Word n,
+                seL4_CapRights_t rights, seL4_Word attrs);
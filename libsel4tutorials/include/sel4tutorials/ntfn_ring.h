@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sel4/sel4.h>
+#include <sel4tutorials/gen_config.h>
+#include <sel4tutorials/ring.h>
+
+/*
+ * A ring of fixed-size items in memory shared between producers and a single consumer, such as
+ * a frame mapped into each of them as in the notifications tutorial, with a notification to
+ * wake the consumer.
+ *
+ * Producers only signal the notification when the ring goes from empty to not empty, so a busy
+ * consumer is not signalled at all. Before waiting on the notification the consumer polls the
+ * ring LibSel4TutorialsNtfnRingPollSpins times, so it does not sleep if more items are about
+ * to arrive.
+ *
+ * Any number of threads may enqueue, one at a time or in batches. Items enqueued in one call
+ * are consecutive in the ring. Only one thread may dequeue.
+ *
+ * Producers publish their items in the order they claimed space, so a producer that is
+ * preempted in the middle of ntfn_ring_enqueue holds up the producers behind it, which yield
+ * until it is done. seL4_Yield only gives way to threads of the same priority, so producers that
+ * share a core must all run at the same priority. A producer of higher priority than another on
+ * its core can wait forever for it. A single producer can run at any priority.
+ */
+
+/* the layout is that of ring_t, with reserved counting the space producers have claimed */
+typedef ring_t ntfn_ring_t;
+
+/*
+ * Set up a ring in a buffer. Must be called once, before any side uses the ring. The other sides
+ * can use the ring at the same address in their own mappings of the buffer.
+ *
+ * @param buf to put the ring in
+ * @param buf_size size of buf. The ring uses the largest power of 2 number of items that fits.
+ * @param item_size size of each item in bytes
+ * @return the ring
+ */
+ntfn_ring_t *ntfn_ring_init(void *buf, size_t buf_size, size_t item_size);
+
+/*
+ * Add up to count items to the ring, and signal ntfn if the ring was empty.
+ *
+ * @param items array of count items
+ * @param ntfn the notification the consumer waits on
+ * @return the number of items added, fewer than count if the ring is full
+ */
+size_t ntfn_ring_enqueue(ntfn_ring_t *ring, const void *items, size_t count, seL4_CPtr ntfn);
+
+/*
+ * Take up to count items from the ring without blocking.
+ *
+ * @param items array to copy up to count items to
+ * @return the number of items taken
+ */
+size_t ntfn_ring_dequeue(ntfn_ring_t *ring, void *items, size_t count);
+
+/*
+ * Take up to count items from the ring, polling and then waiting on ntfn until there is at
+ * least one.
+ *
+ * @return the number of items taken, at least one
+ */
+size_t ntfn_ring_dequeue_wait(ntfn_ring_t *ring, void *items, size_t count, seL4_CPtr ntfn);
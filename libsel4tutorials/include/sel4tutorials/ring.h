@@ -0,0 +1,70 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+
+/*
+ * The layout and the lock-free parts shared by the rings in shared memory, log_ring and
+ * ntfn_ring. Producers add items at head and a single consumer takes them from tail, and each
+ * side only reads the other's index. Both are free-running counts of items, so an index into
+ * data is the count masked by the size.
+ */
+
+/* the producer and consumer indices are kept on separate cache lines of this size */
+#define RING_CACHE_LINE 64
+
+typedef struct ring {
+    /* total items written by producers, which the consumer can read */
+    seL4_Word head;
+    /* total items claimed by producers, for rings with several producers */
+    seL4_Word reserved;
+    /* total items dropped because the ring was full, for rings that drop */
+    seL4_Word dropped;
+    char pad0[RING_CACHE_LINE - 3 * sizeof(seL4_Word)];
+    /* total items read by the consumer */
+    seL4_Word tail;
+    char pad1[RING_CACHE_LINE - sizeof(seL4_Word)];
+    /* number of items, a power of 2 */
+    seL4_Word size;
+    seL4_Word item_size;
+    char data[];
+} ring_t;
+
+/* @return the largest power of 2 that is at most n, for a size that indices can be masked by */
+static inline seL4_Word ring_round_size(seL4_Word n)
+{
+    return BIT(seL4_WordBits - 1 - CLZL(n));
+}
+
+/*
+ * Set up a ring in a buffer. Must be called once, before any side uses the ring.
+ *
+ * @param buf_size size of buf. The ring uses the largest power of 2 number of items that fits.
+ * @param item_size size of each item in bytes
+ */
+ring_t *ring_init(void *buf, size_t buf_size, size_t item_size);
+
+/* copy count items into the ring from index onwards, wrapping at the end of data */
+void ring_copy_in(ring_t *ring, seL4_Word index, const void *items, size_t count);
+
+/* copy count items out of the ring from index onwards, wrapping at the end of data */
+void ring_copy_out(ring_t *ring, seL4_Word index, void *items, size_t count);
+
+/*
+ * For a producer that has just published items from start onwards: signal ntfn if the consumer
+ * had taken everything before them, and so may be waiting in ring_wait_empty.
+ */
+void ring_signal_published(ring_t *ring, seL4_Word start, seL4_CPtr ntfn);
+
+/*
+ * For the consumer once it has found the ring empty: wait on ntfn, unless items were published
+ * since. Between them, this and ring_signal_published never lose a wakeup.
+ */
+void ring_wait_empty(ring_t *ring, seL4_CPtr ntfn);
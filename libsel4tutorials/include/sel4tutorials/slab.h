@@ -0,0 +1,57 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <sel4/sel4.h>
+
+/*
+ * Per object type caches of ready-made objects, for programs that keep creating and
+ * destroying the same kinds of small objects: endpoints, notifications, reply objects,
+ * TCBs and frames. These are the types whose objects can be put back as they were made.
+ *
+ * Each cache holds up to LibSel4TutorialsSlabCapacity objects. An empty cache is refilled
+ * with half that many objects at once through alloc_objects, so most allocations are just a
+ * pop from the cache and need no syscalls.
+ */
+
+typedef struct slab_stats {
+    /* allocations served from the cache */
+    seL4_Word hits;
+    /* allocations that found the cache empty and had to refill it */
+    seL4_Word misses;
+    /* objects returned to the cache */
+    seL4_Word frees;
+    /* objects freed while the cache was full, which were destroyed instead */
+    seL4_Word overflows;
+} slab_stats_t;
+
+/*
+ * Allocate an object of a fixed size type from its cache.
+ *
+ * @param type of the object to allocate, one of the types above
+ * @return a cslot containing the object
+ */
+seL4_CPtr slab_alloc(seL4_BootInfo *info, seL4_Word type);
+
+/*
+ * Return an object allocated with slab_alloc to its cache.
+ *
+ * All caps derived from the object are revoked first, so nothing else can still reach it.
+ * A frame is then unmapped, and a TCB suspended and unbound from its notification, so the
+ * next slab_alloc can map or start it as if it were new. A frame keeps its contents, and a
+ * TCB the rest of its configuration, which the next user sets again before starting it.
+ * If the cache is full the object is freed instead.
+ *
+ * @param cslot of the object, as returned by slab_alloc for the same type
+ * @param type of the object
+ */
+void slab_free(seL4_BootInfo *info, seL4_CPtr cslot, seL4_Word type);
+
+/*
+ * Get the hit and miss counts of the cache for an object type.
+ */
+void slab_get_stats(seL4_Word type, slab_stats_t *stats);
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sel4/sel4.h>
+#include <sel4tutorials/cycles.h>
+#include <sel4tutorials/gen_config.h>
+
+/*
+ * Binary event tracing for code that is too hot to printf from.
+ *
+ * TRACE(event_id, a, b) writes one fixed-size record with a cycle counter timestamp into the
+ * trace buffer of the calling thread, which is set up with trace_init_thread. When the buffer
+ * is full the oldest records are overwritten. trace_dump prints the buffer as hex, which
+ * tools/decode_trace.py in this repository turns back into text or Chrome trace JSON.
+ *
+ * TRACE does nothing unless LibSel4TutorialsTrace is set, or in a thread without a buffer.
+ */
+
+typedef struct trace_record {
+    uint64_t timestamp;
+    uint32_t event_id;
+    /* the thread_id passed to trace_init_thread */
+    uint32_t thread_id;
+    uint64_t a;
+    uint64_t b;
+} trace_record_t;
+
+typedef struct trace_buffer {
+    /* total records written, including those that have been overwritten */
+    seL4_Word count;
+    /* number of records, a power of 2 */
+    seL4_Word size;
+    uint32_t thread_id;
+    trace_record_t records[];
+} trace_buffer_t;
+
+/* the buffer of the calling thread, or NULL */
+extern __thread trace_buffer_t *trace_current;
+
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_TRACE
+#define TRACE(event_id, a, b) trace_write((event_id), (uint64_t) (a), (uint64_t) (b))
+#else
+#define TRACE(event_id, a, b) do { } while (0)
+#endif
+
+static inline void trace_write(uint32_t event_id, uint64_t a, uint64_t b)
+{
+    trace_buffer_t *buffer = trace_current;
+    if (buffer != NULL) {
+        trace_record_t *record = &buffer->records[buffer->count++ & (buffer->size - 1)];
+        record->timestamp = cycles_read();
+        record->event_id = event_id;
+        record->thread_id = buffer->thread_id;
+        record->a = a;
+        record->b = b;
+    }
+}
+
+/*
+ * Give the calling thread a trace buffer. Every thread that traces needs its own buffer and TLS.
+ * This calls cycles_init, so the timestamps count cycles on aarch32 too, where the counter must be
+ * started.
+ *
+ * @param buf to keep the records in
+ * @param buf_size size of buf. The largest power of 2 number of records that fits is used.
+ * @param thread_id recorded in each record to tell threads apart when decoding
+ * @return the buffer, which can also be dumped from another thread with trace_dump_buffer
+ */
+trace_buffer_t *trace_init_thread(void *buf, size_t buf_size, uint32_t thread_id);
+
+/*
+ * Print the records in a trace buffer, oldest first, as lines of the form
+ * "TRACE: <hex bytes of the record>" between "TRACE BEGIN" and "TRACE END" lines. The buffer
+ * should not be written to while it is dumped.
+ */
+void trace_dump_buffer(trace_buffer_t *buffer);
+
+/* Print the records in the calling thread's trace buffer, as for trace_dump_buffer */
+void trace_dump(void);
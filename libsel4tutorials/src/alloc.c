@@ -4,36 +4,532 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+/* Include Kconfig variables. */
+#include <autoconf.h>
+
+#include <stdarg.h>
+#include <stdio.h>
 #include <sel4/sel4.h>
 #include <utils/util.h>
+#include <sel4tutorials/alloc.h>
+#include <sel4tutorials/debug.h>
+#include <sel4tutorials/gen_config.h>
+
+/*
+ * A model of the watermark of each untyped in the bootinfo untyped list, mirroring what the kernel
+ * does on retype: the watermark is first aligned up to the size of the new object and then
+ * moved past it. This lets us find an untyped that has room for an object without having to ask
+ * the kernel by trying retypes until one succeeds.
+ *
+ * The model assumes that nothing else retypes from the bootinfo untypeds. If it is ever wrong,
+ * the retype that disagrees with it fails and the untyped is treated as full from then on.
+ */
+static seL4_Word untyped_watermark[CONFIG_MAX_NUM_BOOTINFO_UNTYPED_CAPS];
+
+/* For each object size, the index into the bootinfo untyped list of the first untyped that
+   may still have room for an object of that size. Every untyped below the cursor is too full,
+   and will stay too full until its arena is reclaimed. */
+static seL4_Word untyped_cursor[seL4_WordBits];
+
+/*
+ * Slots that have been freed with free_slot, as a two level bitmap indexed by slot number in
+ * the root CNode. free_slot_summary has a bit set for each word of free_slot_bitmap that has
+ * any bit set, so the lowest freed slot can be found by scanning only the summary words.
+ * Slots that have never been allocated are still handed out from info->empty.start.
+ */
+#define ROOT_CNODE_SLOTS BIT(CONFIG_ROOT_CNODE_SIZE_BITS)
+static seL4_Word free_slot_bitmap[DIV_ROUND_UP(ROOT_CNODE_SLOTS, seL4_WordBits)];
+static seL4_Word free_slot_summary[DIV_ROUND_UP(ARRAY_SIZE(free_slot_bitmap), seL4_WordBits)];
+
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_RECLAIM
+/*
+ * Each untyped is an arena for the objects retyped from it. An arena counts its live objects,
+ * and once the last one is freed the untyped is revoked and its watermark reset to 0.
+ *
+ * slot_arena records which arena the object in each slot of the root CNode came from,
+ * offset by one so that 0 means the slot does not hold an object from this allocator.
+ */
+static seL4_Word arena_live_objects[CONFIG_MAX_NUM_BOOTINFO_UNTYPED_CAPS];
+static seL4_Uint16 slot_arena[ROOT_CNODE_SLOTS];
+#endif
+
+static alloc_fit_policy_t fit_policy = ALLOC_FIRST_FIT;
+
+/* number of seL4_Untyped_Retype invocations made through alloc_retype */
+static seL4_Word retype_calls;
+
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_STATS
+static struct {
+    /* objects created of each type */
+    seL4_Word objects[seL4_ObjectTypeCount];
+    /* retypes that returned an error */
+    seL4_Word failed_retypes;
+    /* bytes of each untyped skipped over to align objects */
+    seL4_Word padding[CONFIG_MAX_NUM_BOOTINFO_UNTYPED_CAPS];
+    seL4_Word slots_in_use;
+    seL4_Word peak_slots_in_use;
+} stats;
+#endif
+
+static void stats_slots(seL4_Word allocated, seL4_Word freed)
+{
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_STATS
+    stats.slots_in_use += allocated - freed;
+    stats.peak_slots_in_use = MAX(stats.peak_slots_in_use, stats.slots_in_use);
+#endif
+}
+
+/* note that n objects of the given type were retyped from untyped i, after skipping padding
+   bytes to align them */
+static void stats_objects(seL4_Word type, seL4_Word n, seL4_Word i, seL4_Word padding)
+{
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_STATS
+    stats.objects[type] += n;
+    stats.padding[i] += padding;
+#endif
+}
+
+static void stats_failed_retype(void)
+{
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_STATS
+    /* alloc_mt retypes from several threads at once */
+    __atomic_fetch_add(&stats.failed_retypes, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+seL4_Word alloc_object_size_bits(seL4_Word type, seL4_Word size_bits)
+{
+    switch (type) {
+    case seL4_UntypedObject:
+        return size_bits;
+    case seL4_TCBObject:
+        return seL4_TCBBits;
+    case seL4_EndpointObject:
+        return seL4_EndpointBits;
+    case seL4_NotificationObject:
+        return seL4_NotificationBits;
+    case seL4_CapTableObject:
+        return seL4_SlotBits + size_bits;
+#ifdef CONFIG_KERNEL_MCS
+    case seL4_SchedContextObject:
+        return size_bits;
+    case seL4_ReplyObject:
+        return seL4_ReplyBits;
+#endif
+#ifdef CONFIG_ARCH_X86
+    case seL4_X86_4K:
+        return seL4_PageBits;
+    case seL4_X86_LargePageObject:
+        return seL4_LargePageBits;
+    case seL4_X86_PageTableObject:
+        return seL4_PageTableBits;
+    case seL4_X86_PageDirectoryObject:
+        return seL4_PageDirBits;
+#endif
+#ifdef CONFIG_ARCH_X86_64
+    case seL4_X86_PDPTObject:
+        return seL4_PDPTBits;
+    case seL4_X64_PML4Object:
+        return seL4_PML4Bits;
+    case seL4_X64_HugePageObject:
+        return seL4_HugePageBits;
+#endif
+#ifdef CONFIG_ARCH_AARCH32
+    case seL4_ARM_SmallPageObject:
+        return seL4_PageBits;
+    case seL4_ARM_LargePageObject:
+        return seL4_LargePageBits;
+    case seL4_ARM_SectionObject:
+        return seL4_SectionBits;
+    case seL4_ARM_SuperSectionObject:
+        return seL4_SuperSectionBits;
+    case seL4_ARM_PageTableObject:
+        return seL4_PageTableBits;
+    case seL4_ARM_PageDirectoryObject:
+        return seL4_PageDirBits;
+#endif
+    default:
+        return 0;
+    }
+}
+
+seL4_Word alloc_frame_type(seL4_Word size_bits)
+{
+    switch (size_bits) {
+#ifdef CONFIG_ARCH_X86
+    case seL4_PageBits:
+        return seL4_X86_4K;
+    case seL4_LargePageBits:
+        return seL4_X86_LargePageObject;
+#endif
+#ifdef CONFIG_ARCH_X86_64
+    case seL4_HugePageBits:
+        return seL4_X64_HugePageObject;
+#endif
+#ifdef CONFIG_ARCH_AARCH32
+    case seL4_PageBits:
+        return seL4_ARM_SmallPageObject;
+    case seL4_LargePageBits:
+        return seL4_ARM_LargePageObject;
+    case seL4_SectionBits:
+        return seL4_ARM_SectionObject;
+    case seL4_SuperSectionBits:
+        return seL4_ARM_SuperSectionObject;
+#endif
+    default:
+        ZF_LOGF("No frame object of size 2^%lu", (unsigned long) size_bits);
+        return 0;
+    }
+}
+
+/* check that size_bits is in the range the kernel accepts for a variably sized object */
+static bool valid_size_bits(seL4_Word type, seL4_Word size_bits)
+{
+    switch (type) {
+    case seL4_UntypedObject:
+        return size_bits >= seL4_MinUntypedBits && size_bits <= seL4_MaxUntypedBits;
+    case seL4_CapTableObject:
+        return size_bits > 0 && size_bits < seL4_WordBits - seL4_SlotBits;
+#ifdef CONFIG_KERNEL_MCS
+    case seL4_SchedContextObject:
+        return size_bits >= seL4_MinSchedContextBits && size_bits <= seL4_MaxUntypedBits;
+#endif
+    default:
+        return true;
+    }
+}
+
+void alloc_set_fit_policy(alloc_fit_policy_t policy)
+{
+    fit_policy = policy;
+}
+
+/* return the number of free bytes left in an untyped after aligning for an object of the given
+   size, or 0 if the object does not fit */
+static seL4_Word untyped_space_for(seL4_BootInfo *info, seL4_Word i, seL4_Word obj_bits)
+{
+    seL4_UntypedDesc *desc = &info->untypedList[i];
+    if (desc->isDevice || desc->sizeBits < obj_bits) {
+        return 0;
+    }
+    seL4_Word aligned = ROUND_UP(untyped_watermark[i], obj_bits);
+    seL4_Word size = BIT(desc->sizeBits);
+    if (aligned >= size || size - aligned < BIT(obj_bits)) {
+        return 0;
+    }
+    return size - aligned;
+}
+
+/* pick an untyped with room for an object of the given size according to the fit policy,
+   returning the number of untypeds if there is none */
+static seL4_Word find_untyped(seL4_BootInfo *info, seL4_Word obj_bits)
+{
+    seL4_Word num_untypeds = info->untyped.end - info->untyped.start;
+    seL4_Word best = num_untypeds;
+    seL4_Word best_space = 0;
+
+    for (seL4_Word i = untyped_cursor[obj_bits]; i < num_untypeds; i++) {
+        seL4_Word space = untyped_space_for(info, i, obj_bits);
+        if (space == 0) {
+            if (i == untyped_cursor[obj_bits]) {
+                untyped_cursor[obj_bits]++;
+            }
+            continue;
+        }
+        if (fit_policy == ALLOC_FIRST_FIT) {
+            return i;
+        }
+        if (best == num_untypeds || space < best_space) {
+            best = i;
+            best_space = space;
+        }
+    }
+    return best;
+}
+
+seL4_Word alloc_object_capacity(seL4_BootInfo *info, seL4_Word type, seL4_Word size_bits)
+{
+    seL4_Word obj_bits = alloc_object_size_bits(type, size_bits);
+    if (obj_bits == 0) {
+        return 0;
+    }
+    seL4_Word num_untypeds = info->untyped.end - info->untyped.start;
+    seL4_Word capacity = 0;
+    for (seL4_Word i = untyped_cursor[obj_bits]; i < num_untypeds; i++) {
+        capacity += untyped_space_for(info, i, obj_bits) >> obj_bits;
+    }
+    return capacity;
+}
+
+seL4_Error alloc_retype(seL4_CPtr untyped, seL4_Word type, seL4_Word size_bits, seL4_CPtr first, seL4_Word count)
+{
+    __atomic_fetch_add(&retype_calls, 1, __ATOMIC_RELAXED);
+    seL4_Error error = seL4_Untyped_Retype(untyped, type, size_bits, seL4_CapInitThreadCNode, 0, 0, first, count);
+    if (error != seL4_NoError) {
+        stats_failed_retype();
+    }
+    return error;
+}
+
+seL4_Error alloc_delete(seL4_CPtr slot)
+{
+    return seL4_CNode_Delete(seL4_CapInitThreadCNode, slot, seL4_WordBits);
+}
+
+seL4_Error alloc_revoke(seL4_CPtr slot)
+{
+    return seL4_CNode_Revoke(seL4_CapInitThreadCNode, slot, seL4_WordBits);
+}
+
+/* fall back to asking the kernel for objects whose size we do not know */
+static seL4_Error retype_unknown_size(seL4_BootInfo *info, seL4_Word type, seL4_Word size_bits, seL4_CPtr cslot,
+                                      seL4_Word *untyped_index)
+{
+    seL4_Word num_untypeds = info->untyped.end - info->untyped.start;
+    for (seL4_Word i = 0; i < num_untypeds; i++) {
+        if (!info->untypedList[i].isDevice) {
+            seL4_Error error = alloc_retype(info->untyped.start + i, type, size_bits, cslot, 1);
+            if (error != seL4_NotEnoughMemory) {
+                *untyped_index = i;
+                return error;
+            }
+        }
+    }
+    return seL4_NotEnoughMemory;
+}
+
+/* note that n objects in consecutive slots starting at first were retyped from untyped i */
+static void arena_add(seL4_Word i, seL4_CPtr first, seL4_Word n)
+{
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_RECLAIM
+    arena_live_objects[i] += n;
+    for (seL4_Word j = 0; j < n; j++) {
+        slot_arena[first + j] = i + 1;
+    }
+#endif
+}
+
+static void mark_slot_free(seL4_CPtr slot)
+{
+    seL4_Word word = slot / seL4_WordBits;
+    free_slot_bitmap[word] |= BIT(slot % seL4_WordBits);
+    free_slot_summary[word / seL4_WordBits] |= BIT(word % seL4_WordBits);
+}
+
+static void mark_slot_used(seL4_CPtr slot)
+{
+    seL4_Word word = slot / seL4_WordBits;
+    free_slot_bitmap[word] &= ~BIT(slot % seL4_WordBits);
+    if (free_slot_bitmap[word] == 0) {
+        free_slot_summary[word / seL4_WordBits] &= ~BIT(word % seL4_WordBits);
+    }
+}
+
+/* find the lowest run of count freed slots, returning 0 if there is none */
+static seL4_CPtr find_free_slots(seL4_Word count)
+{
+    seL4_Word run = 0;
+    for (seL4_CPtr slot = 0; slot < ROOT_CNODE_SLOTS; slot++) {
+        seL4_Word word = free_slot_bitmap[slot / seL4_WordBits];
+        if (word == 0) {
+            /* skip the rest of an empty word */
+            run = 0;
+            slot += seL4_WordBits - 1 - slot % seL4_WordBits;
+        } else if (word & BIT(slot % seL4_WordBits)) {
+            if (++run == count) {
+                return slot + 1 - count;
+            }
+        } else {
+            run = 0;
+        }
+    }
+    return 0;
+}
 
 seL4_CPtr alloc_slot(seL4_BootInfo *info)
 {
+    for (seL4_Word i = 0; i < ARRAY_SIZE(free_slot_summary); i++) {
+        if (free_slot_summary[i] != 0) {
+            seL4_Word word = i * seL4_WordBits + CTZL(free_slot_summary[i]);
+            seL4_CPtr slot = word * seL4_WordBits + CTZL(free_slot_bitmap[word]);
+            mark_slot_used(slot);
+            stats_slots(1, 0);
+            return slot;
+        }
+    }
+
     ZF_LOGF_IF(info->empty.start == info->empty.end, "No CSlots left!");
     seL4_CPtr next_free_slot = info->empty.start++;
+    stats_slots(1, 0);
     return next_free_slot;
 }
 
-/* a very simple allocation function that iterates through the untypeds in boot info until
-   a retype succeeds */
-seL4_CPtr alloc_object(seL4_BootInfo *info, seL4_Word type)
+seL4_CPtr alloc_slot_range(seL4_BootInfo *info, seL4_Word count)
 {
-    seL4_CPtr cslot = alloc_slot(info);
+    assert(count > 0);
+    if (count == 1) {
+        return alloc_slot(info);
+    }
 
-    /* keep trying to retype until we succeed */
-    seL4_Error error = seL4_NotEnoughMemory;
-    for (seL4_CPtr untyped = info->untyped.start; untyped < info->untyped.end; untyped++) {
-        seL4_UntypedDesc *desc = &info->untypedList[untyped - info->untyped.start];
-        if (!desc->isDevice) {
-            seL4_Error error = seL4_Untyped_Retype(untyped, type, 0, seL4_CapInitThreadCNode, 0, 0, cslot, 1);
-            if (error == seL4_NoError) {
-                return cslot;
-            } else if (error != seL4_NotEnoughMemory) {
-                ZF_LOGF_IF(error != seL4_NotEnoughMemory, "Failed to allocate untyped");
-            }
+    if (info->empty.end - info->empty.start >= count) {
+        seL4_CPtr first = info->empty.start;
+        info->empty.start += count;
+        stats_slots(count, 0);
+        return first;
+    }
+
+    seL4_CPtr first = find_free_slots(count);
+    ZF_LOGF_IF(first == 0, "No range of %lu CSlots left!", (unsigned long) count);
+    for (seL4_Word j = 0; j < count; j++) {
+        mark_slot_used(first + j);
+    }
+    stats_slots(count, 0);
+    return first;
+}
+
+void free_slot(seL4_CPtr slot)
+{
+    assert(slot < ROOT_CNODE_SLOTS);
+    seL4_Error error = alloc_delete(slot);
+    ZF_LOGF_IF(error != seL4_NoError, "Failed to delete slot %lu", (unsigned long) slot);
+    mark_slot_free(slot);
+    stats_slots(0, 1);
+}
+
+seL4_CPtr alloc_objects(seL4_BootInfo *info, seL4_Word type, seL4_Word size_bits, seL4_Word count,
+                        seL4_CPtr *out_slots)
+{
+    ZF_LOGF_IF(!valid_size_bits(type, size_bits), "Invalid size_bits %lu for object type %lu",
+               (unsigned long) size_bits, (unsigned long) type);
+    if (count == 0) {
+        return seL4_CapNull;
+    }
+
+    /* the destination of a retype is a contiguous range of slots */
+    seL4_CPtr first = alloc_slot_range(info, count);
+    for (seL4_Word j = 0; out_slots != NULL && j < count; j++) {
+        out_slots[j] = first + j;
+    }
+
+    seL4_Word obj_bits = alloc_object_size_bits(type, size_bits);
+    if (obj_bits == 0) {
+        for (seL4_Word j = 0; j < count; j++) {
+            seL4_Word i;
+            seL4_Error error = retype_unknown_size(info, type, size_bits, first + j, &i);
+            ZF_LOGF_IF(error == seL4_NotEnoughMemory, "Out of untyped memory");
+            ZF_LOGF_IF(error != seL4_NoError, "Failed to allocate untyped");
+            arena_add(i, first + j, 1);
+            stats_objects(type, 1, i, 0);
+        }
+        return first;
+    }
+
+    seL4_Word num_untypeds = info->untyped.end - info->untyped.start;
+    seL4_Word done = 0;
+    while (done < count) {
+        seL4_Word i = find_untyped(info, obj_bits);
+        ZF_LOGF_IF(i == num_untypeds, "Out of untyped memory");
+
+        /* create as many of the remaining objects as this untyped has room for */
+        seL4_Word n = MIN(untyped_space_for(info, i, obj_bits) >> obj_bits, count - done);
+        n = MIN(n, CONFIG_RETYPE_FAN_OUT_LIMIT);
+        seL4_Error error = alloc_retype(info->untyped.start + i, type, size_bits, first + done, n);
+        if (error == seL4_NotEnoughMemory) {
+            /* the model was wrong, stop using this untyped */
+            untyped_watermark[i] = BIT(info->untypedList[i].sizeBits);
+            continue;
+        }
+        ZF_LOGF_IF(error != seL4_NoError, "Failed to allocate untyped");
+        seL4_Word aligned = ROUND_UP(untyped_watermark[i], obj_bits);
+        stats_objects(type, n, i, aligned - untyped_watermark[i]);
+        untyped_watermark[i] = aligned + (n << obj_bits);
+        arena_add(i, first + done, n);
+        done += n;
+    }
+    return first;
+}
+
+seL4_CPtr alloc_object(seL4_BootInfo *info, seL4_Word type, seL4_Word size_bits)
+{
+    return alloc_objects(info, type, size_bits, 1, NULL);
+}
+
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_RECLAIM
+void free_object(seL4_BootInfo *info, seL4_CPtr cslot)
+{
+    ZF_LOGF_IF(cslot >= ARRAY_SIZE(slot_arena) || slot_arena[cslot] == 0, "Slot %lu does not hold an allocated object",
+               (unsigned long) cslot);
+    seL4_Word i = slot_arena[cslot] - 1;
+    slot_arena[cslot] = 0;
+
+    free_slot(cslot);
+
+    assert(arena_live_objects[i] > 0);
+    if (--arena_live_objects[i] > 0) {
+        return;
+    }
+
+    /* The arena is empty. Revoke the untyped to remove anything still derived from it, such
+       as copies of the objects' caps, after which the kernel starts retyping it from 0 again. */
+    seL4_Error error = alloc_revoke(info->untyped.start + i);
+    ZF_LOGF_IF(error != seL4_NoError, "Failed to revoke untyped");
+    untyped_watermark[i] = 0;
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_STATS
+    stats.padding[i] = 0;
+#endif
+    for (seL4_Word bits = 0; bits < ARRAY_SIZE(untyped_cursor); bits++) {
+        untyped_cursor[bits] = MIN(untyped_cursor[bits], i);
+    }
+}
+#endif
+
+seL4_Word alloc_retype_count(void)
+{
+    return __atomic_load_n(&retype_calls, __ATOMIC_RELAXED);
+}
+
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_STATS
+static void stats_print(const char *format, ...)
+{
+    char buf[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    kernel_putchar_write(buf, MIN((size_t) MAX(len, 0), sizeof(buf) - 1));
+}
+
+void alloc_stats_dump(seL4_BootInfo *info)
+{
+    stats_print("Allocator statistics\n");
+    stats_print("  retypes: %lu, failed: %lu\n", (unsigned long) retype_calls, (unsigned long) stats.failed_retypes);
+    stats_print("  slots in use: %lu, peak: %lu\n", (unsigned long) stats.slots_in_use,
+                (unsigned long) stats.peak_slots_in_use);
+
+    stats_print("  Type\tObjects\n");
+    for (seL4_Word type = 0; type < seL4_ObjectTypeCount; type++) {
+        if (stats.objects[type] != 0) {
+            stats_print("  %lu\t%lu\n", (unsigned long) type, (unsigned long) stats.objects[type]);
         }
     }
 
-    ZF_LOGF_IF(error == seL4_NotEnoughMemory, "Out of untyped memory");
-    return cslot;
+    /* only list the untypeds that have been used */
+    seL4_Word total_used = 0;
+    seL4_Word total_padding = 0;
+    stats_print("  Untyped\tSize\tUsed\tPadding\tFree\n");
+    for (seL4_Word i = 0; i < info->untyped.end - info->untyped.start; i++) {
+        seL4_UntypedDesc *desc = &info->untypedList[i];
+        if (desc->isDevice || untyped_watermark[i] == 0) {
+            continue;
+        }
+        seL4_Word size = BIT(desc->sizeBits);
+        seL4_Word used = MIN(untyped_watermark[i], size);
+        stats_print("  %p\t2^%d\t%lu\t%lu\t%lu\n", (void *) desc->paddr, desc->sizeBits, (unsigned long) used,
+                    (unsigned long) stats.padding[i], (unsigned long)(size - used));
+        total_used += used;
+        total_padding += stats.padding[i];
+    }
+    stats_print("  bytes used: %lu, of which alignment padding: %lu\n", (unsigned long) total_used,
+                (unsigned long) total_padding);
 }
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Include Kconfig variables. */
+#include <autoconf.h>
+
+#include <string.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/alloc.h>
+
+/*
+ * Table of the device untypeds that have not been retyped yet, sorted by physical address.
+ * It starts out as the device untypeds in bootinfo. Allocating a frame splits the untyped
+ * that covers it in half repeatedly until the half containing the frame is the size of the
+ * frame, and each half that is split off on the way is added back to the table.
+ */
+#define DEVICE_TABLE_SIZE (CONFIG_MAX_NUM_BOOTINFO_UNTYPED_CAPS + 256)
+
+typedef struct device_untyped {
+    seL4_Word paddr;
+    seL4_Word size_bits;
+    seL4_CPtr cap;
+} device_untyped_t;
+
+static device_untyped_t device_table[DEVICE_TABLE_SIZE];
+static seL4_Word device_table_count;
+static bool device_table_initialised;
+
+/* return the index of the first entry with a paddr greater than paddr */
+static seL4_Word device_table_upper_bound(seL4_Word paddr)
+{
+    seL4_Word low = 0;
+    seL4_Word high = device_table_count;
+    while (low < high) {
+        seL4_Word mid = low + (high - low) / 2;
+        if (device_table[mid].paddr <= paddr) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static seL4_Error device_table_insert(seL4_Word paddr, seL4_Word size_bits, seL4_CPtr cap)
+{
+    if (device_table_count == DEVICE_TABLE_SIZE) {
+        return seL4_NotEnoughMemory;
+    }
+    seL4_Word i = device_table_upper_bound(paddr);
+    memmove(&device_table[i + 1], &device_table[i], (device_table_count - i) * sizeof(device_table[0]));
+    device_table[i] = (device_untyped_t) {
+        .paddr = paddr, .size_bits = size_bits, .cap = cap
+    };
+    device_table_count++;
+    return seL4_NoError;
+}
+
+static void device_table_remove(seL4_Word i)
+{
+    device_table_count--;
+    memmove(&device_table[i], &device_table[i + 1], (device_table_count - i) * sizeof(device_table[0]));
+}
+
+static void device_table_init(seL4_BootInfo *info)
+{
+    for (seL4_CPtr slot = info->untyped.start; slot < info->untyped.end; slot++) {
+        seL4_UntypedDesc *desc = &info->untypedList[slot - info->untyped.start];
+        if (desc->isDevice) {
+            /* the table has room for every untyped in bootinfo */
+            seL4_Error error = device_table_insert(desc->paddr, desc->sizeBits, slot);
+            ZF_LOGF_IFERR(error, "Device untyped table is full");
+        }
+    }
+    device_table_initialised = true;
+}
+
+seL4_CPtr alloc_device_frame(seL4_BootInfo *info, seL4_Word paddr, seL4_Word size_bits)
+{
+    seL4_Word frame_type = alloc_frame_type(size_bits);
+    ZF_LOGF_IF(!IS_ALIGNED(paddr, size_bits), "Device frame address %p is not aligned to its size", (void *) paddr);
+    if (!device_table_initialised) {
+        device_table_init(info);
+    }
+
+    seL4_Word i = device_table_upper_bound(paddr);
+    ZF_LOGF_IF(i == 0, "No device untyped covers %p", (void *) paddr);
+    device_untyped_t ut = device_table[--i];
+    ZF_LOGF_IF(paddr - ut.paddr >= BIT(ut.size_bits) || ut.size_bits < size_bits,
+               "No device untyped covers %p, or it has already been allocated", (void *) paddr);
+    /* each split adds a half to the table, so check there is room for them before splitting */
+    if (device_table_count - 1 + (ut.size_bits - size_bits) > DEVICE_TABLE_SIZE) {
+        return seL4_CapNull;
+    }
+    device_table_remove(i);
+
+    /* split in half until the untyped is the size of the frame */
+    while (ut.size_bits > size_bits) {
+        seL4_CPtr halves = alloc_slot_range(info, 2);
+        seL4_Word half_bits = ut.size_bits - 1;
+        seL4_Error error = alloc_retype(ut.cap, seL4_UntypedObject, half_bits, halves, 2);
+        ZF_LOGF_IF(error != seL4_NoError, "Failed to split device untyped");
+
+        seL4_Word high_paddr = ut.paddr + BIT(half_bits);
+        if (paddr >= high_paddr) {
+            error = device_table_insert(ut.paddr, half_bits, halves);
+            ut.paddr = high_paddr;
+            ut.cap = halves + 1;
+        } else {
+            error = device_table_insert(high_paddr, half_bits, halves + 1);
+            ut.cap = halves;
+        }
+        ZF_LOGF_IFERR(error, "Device untyped table is full after checking for room");
+        ut.size_bits = half_bits;
+    }
+
+    seL4_CPtr frame = alloc_slot(info);
+    seL4_Error error = alloc_retype(ut.cap, frame_type, 0, frame, 1);
+    ZF_LOGF_IF(error != seL4_NoError, "Failed to retype device frame");
+    return frame;
+}
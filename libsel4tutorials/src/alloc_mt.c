@@ -0,0 +1,120 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Include Kconfig variables. */
+#include <autoconf.h>
+
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/alloc.h>
+#include <sel4tutorials/alloc_mt.h>
+
+#define MAX_POOLS 64
+
+/* the slots set aside by alloc_mt_init, handed out from next_slot upwards */
+static seL4_CPtr next_slot;
+static seL4_CPtr slots_end;
+
+/* the untyped pools, claimed in order by incrementing next_pool */
+static seL4_CPtr pool_caps[MAX_POOLS];
+static seL4_Word num_pools;
+static seL4_Word next_pool;
+static seL4_Word pool_size_bits;
+
+void alloc_mt_init(seL4_BootInfo *info, seL4_Word slots, seL4_Word pools, seL4_Word size_bits)
+{
+    ZF_LOGF_IF(pools > MAX_POOLS, "Too many pools, at most %d are supported", MAX_POOLS);
+    next_slot = alloc_slot_range(info, slots);
+    slots_end = next_slot + slots;
+
+    alloc_objects(info, seL4_UntypedObject, size_bits, pools, pool_caps);
+    num_pools = pools;
+    pool_size_bits = size_bits;
+    next_pool = 0;
+}
+
+void alloc_mt_thread_init(alloc_mt_thread_t *thread)
+{
+    thread->pool = ALLOC_MT_NO_POOL;
+    thread->watermark = 0;
+    for (seL4_Word i = 0; i < ARRAY_SIZE(thread->magazines); i++) {
+        thread->magazines[i].count = 0;
+    }
+}
+
+/* take count consecutive slots from the range set aside by alloc_mt_init */
+static seL4_CPtr take_slots(seL4_Word count)
+{
+    seL4_CPtr first = __atomic_fetch_add(&next_slot, count, __ATOMIC_RELAXED);
+    ZF_LOGF_IF(first + count > slots_end, "No CSlots left!");
+    return first;
+}
+
+seL4_CPtr alloc_mt_slot(void)
+{
+    return take_slots(1);
+}
+
+/* retype up to count objects into consecutive slots from the thread's pool, claiming a new
+   pool if the current one is full. Returns the first slot and sets count to how many objects
+   were created. */
+static seL4_CPtr retype_from_pool(alloc_mt_thread_t *thread, seL4_Word type, seL4_Word size_bits,
+                                  seL4_Word *count)
+{
+    seL4_Word obj_bits = alloc_object_size_bits(type, size_bits);
+    ZF_LOGF_IF(obj_bits == 0 || obj_bits > pool_size_bits, "Object type %lu cannot be allocated from a pool",
+               (unsigned long) type);
+
+    while (true) {
+        if (thread->pool != ALLOC_MT_NO_POOL) {
+            seL4_Word aligned = ROUND_UP(thread->watermark, obj_bits);
+            seL4_Word fit = aligned < BIT(pool_size_bits) ? (BIT(pool_size_bits) - aligned) >> obj_bits : 0;
+            if (fit > 0) {
+                seL4_Word n = MIN(MIN(fit, *count), CONFIG_RETYPE_FAN_OUT_LIMIT);
+                seL4_CPtr first = take_slots(n);
+                seL4_Error error = alloc_retype(pool_caps[thread->pool], type, size_bits, first, n);
+                ZF_LOGF_IF(error != seL4_NoError, "Failed to retype from pool");
+                thread->watermark = aligned + (n << obj_bits);
+                *count = n;
+                return first;
+            }
+        }
+
+        /* claim a pool nobody else has */
+        thread->pool = __atomic_fetch_add(&next_pool, 1, __ATOMIC_RELAXED);
+        thread->watermark = 0;
+        ZF_LOGF_IF(thread->pool >= num_pools, "Out of untyped pools");
+    }
+}
+
+seL4_CPtr alloc_mt_object(alloc_mt_thread_t *thread, seL4_Word type, seL4_Word size_bits)
+{
+    assert(type < seL4_ObjectTypeCount);
+    seL4_Word count = 1;
+
+    switch (type) {
+    case seL4_UntypedObject:
+    case seL4_CapTableObject:
+#ifdef CONFIG_KERNEL_MCS
+    case seL4_SchedContextObject:
+#endif
+        /* variably sized objects are created one at a time */
+        return retype_from_pool(thread, type, size_bits, &count);
+    default:
+        break;
+    }
+
+    alloc_mt_magazine_t *magazine = &thread->magazines[type];
+    if (magazine->count == 0) {
+        count = ALLOC_MT_MAGAZINE_SIZE;
+        seL4_CPtr first = retype_from_pool(thread, type, 0, &count);
+        for (seL4_Word i = 0; i < count; i++) {
+            magazine->objects[i] = first + i;
+        }
+        magazine->count = count;
+    }
+    return magazine->objects[--magazine->count];
+}
@@ -7,18 +7,69 @@
 /* Include Kconfig variables. */
 #include <autoconf.h>
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <sel4/sel4.h>
 #include <arch_stdio.h>
 #include <utils/attribute.h>
+#include <sel4tutorials/debug.h>
+#include <sel4tutorials/gen_config.h>
+
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER
+/* Each thread collects its output a line at a time, so that one thread's part of a line is not
+   printed in the middle of another's. A thread preempted while it prints a line can still be. */
+static __thread struct {
+    char data[CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER_SIZE];
+    size_t len;
+} putchar_buffer;
+#endif
+
+static void debug_putchars(char *data, size_t count)
+{
+#ifdef CONFIG_DEBUG_BUILD
+    /* The kernel has no call for printing more than one character at a time */
+    for (size_t i = 0; i < count; i++) {
+        seL4_DebugPutChar(data[i]);
+    }
+#endif
+}
+
+void kernel_putchar_flush(void)
+{
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER
+    debug_putchars(putchar_buffer.data, putchar_buffer.len);
+    putchar_buffer.len = 0;
+#endif
+}
+
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER
+/* fflush is linked with --wrap, so that it writes out this thread's buffer after the C
+   library's own buffer has been written into it */
+int __real_fflush(FILE *stream);
+
+int __wrap_fflush(FILE *stream)
+{
+    int ret = __real_fflush(stream);
+    if (stream == NULL || stream == stdout || stream == stderr) {
+        kernel_putchar_flush();
+    }
+    return ret;
+}
+#endif
 
 /* allow printf to use kernel debug printing */
 size_t kernel_putchar_write(void *data, size_t count)
 {
-#ifdef CONFIG_DEBUG_BUILD
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER
     char *cdata = (char *)data;
     for (size_t i = 0; i < count; i++) {
-        seL4_DebugPutChar(cdata[i]);
+        putchar_buffer.data[putchar_buffer.len++] = cdata[i];
+        if (cdata[i] == '\n' || putchar_buffer.len == sizeof(putchar_buffer.data)) {
+            kernel_putchar_flush();
+        }
     }
+#else
+    debug_putchars(data, count);
 #endif
     return count;
 }
@@ -26,6 +77,9 @@ size_t kernel_putchar_write(void *data, size_t count)
 void CONSTRUCTOR(200) register_debug_putchar(void)
 {
     sel4muslcsys_register_stdio_write_fn(kernel_putchar_write);
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_PUTCHAR_BUFFER
+    atexit(kernel_putchar_flush);
+#endif
 }
 
 /* set a thread's name for debugging purposes */
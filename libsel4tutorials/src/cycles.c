@@ -0,0 +1,103 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Include Kconfig variables. */
+#include <autoconf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utils/util.h>
+#include <sel4tutorials/cycles.h>
+
+#define OVERHEAD_TRIES 64
+
+void cycles_init(void)
+{
+#if defined(CONFIG_ARCH_AARCH32) && defined(CONFIG_EXPORT_PMU_USER)
+    uint32_t pmcr;
+    asm volatile("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+    /* enable the counters and count every cycle rather than every 64 */
+    pmcr = (pmcr | BIT(0)) & ~BIT(3);
+    asm volatile("mcr p15, 0, %0, c9, c12, 0" :: "r"(pmcr));
+    /* enable the cycle counter */
+    asm volatile("mcr p15, 0, %0, c9, c12, 1" :: "r"(BIT(31)));
+#endif
+}
+
+uint64_t cycles_overhead(void)
+{
+    uint64_t min = UINT64_MAX;
+    for (int i = 0; i < OVERHEAD_TRIES; i++) {
+        uint64_t start = cycles_read();
+        uint64_t end = cycles_read_ordered();
+        min = MIN(min, cycles_elapsed(start, end));
+    }
+    return min;
+}
+
+uint64_t cycles_calibrate(uint64_t (*now_ns)(void *cookie), void *cookie, uint64_t interval_ns)
+{
+    /* start on a tick of the reference clock so that its granularity does not count */
+    uint64_t first = now_ns(cookie);
+    uint64_t start_ns;
+    while ((start_ns = now_ns(cookie)) == first);
+    uint64_t start = cycles_read();
+
+    uint64_t end_ns;
+    while ((end_ns = now_ns(cookie)) - start_ns < interval_ns);
+    uint64_t end = cycles_read_ordered();
+
+    ZF_LOGF_IF(end == start, "No cycle counter to calibrate");
+    uint64_t elapsed_ns = end_ns - start_ns;
+    return (cycles_elapsed(start, end) * 1000 + elapsed_ns / 2) / elapsed_ns;
+}
+
+void cycles_stats_init(cycles_stats_t *stats, uint64_t *samples, size_t capacity, uint64_t overhead)
+{
+    *stats = (cycles_stats_t) {
+        .samples = samples,
+        .capacity = capacity,
+        .overhead = overhead,
+    };
+}
+
+static int compare_samples(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+void cycles_stats_summarise(cycles_stats_t *stats, cycles_summary_t *summary)
+{
+    memset(summary, 0, sizeof(*summary));
+    size_t n = stats->count;
+    if (n == 0) {
+        return;
+    }
+    qsort(stats->samples, n, sizeof(stats->samples[0]), compare_samples);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += stats->samples[i];
+    }
+    summary->count = n;
+    summary->min = stats->samples[0];
+    summary->median = stats->samples[n / 2];
+    /* nearest rank */
+    summary->p99 = stats->samples[DIV_ROUND_UP(n * 99, 100) - 1];
+    summary->max = stats->samples[n - 1];
+    summary->mean = total / n;
+}
+
+void cycles_summary_print(const char *name, cycles_summary_t *summary)
+{
+    printf("%s: n %zu min %llu median %llu p99 %llu max %llu mean %llu\n", name, summary->count,
+           (unsigned long long) summary->min, (unsigned long long) summary->median,
+           (unsigned long long) summary->p99, (unsigned long long) summary->max,
+           (unsigned long long) summary->mean);
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Include Kconfig variables. */
+#include <autoconf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/fastpath.h>
+
+#ifdef CONFIG_DEBUG_BUILD
+
+#define MAX_SITES 32
+#define MAX_ENDPOINTS 16
+
+static const char *reason_names[FASTPATH_NUM_REASONS] = {
+    [FASTPATH_EXTRA_CAPS] = "extra caps",
+    [FASTPATH_LONG_MESSAGE] = "long message",
+    [FASTPATH_LOW_PRIORITY] = "lower priority receiver",
+};
+
+/* a call site that has missed the fastpath. file is set last, once the entry is filled in. */
+typedef struct site {
+    const char *file;
+    int line;
+    const char *call;
+    seL4_Word misses[FASTPATH_NUM_REASONS];
+} site_t;
+
+static site_t sites[MAX_SITES];
+static seL4_Word num_sites;
+static seL4_Word sites_dropped;
+static seL4_Word checked_calls;
+static seL4_Word missed_calls;
+
+static struct {
+    seL4_CPtr ep;
+    seL4_Word prio;
+} endpoints[MAX_ENDPOINTS];
+static seL4_Word num_endpoints;
+
+static __thread seL4_Word own_prio;
+static __thread bool own_prio_known;
+
+static bool dump_registered;
+
+void fastpath_set_priority(seL4_Word prio)
+{
+    own_prio = prio;
+    own_prio_known = true;
+}
+
+void fastpath_set_endpoint_priority(seL4_CPtr ep, seL4_Word prio)
+{
+    for (seL4_Word i = 0; i < num_endpoints; i++) {
+        if (endpoints[i].ep == ep) {
+            endpoints[i].prio = prio;
+            return;
+        }
+    }
+    ZF_LOGF_IF(num_endpoints == MAX_ENDPOINTS, "Too many endpoints, at most %d are supported", MAX_ENDPOINTS);
+    endpoints[num_endpoints].ep = ep;
+    endpoints[num_endpoints].prio = prio;
+    num_endpoints++;
+}
+
+static site_t *find_site(const char *file, int line, const char *call)
+{
+    seL4_Word n = MIN(__atomic_load_n(&num_sites, __ATOMIC_ACQUIRE), MAX_SITES);
+    for (seL4_Word i = 0; i < n; i++) {
+        if (__atomic_load_n(&sites[i].file, __ATOMIC_ACQUIRE) == file && sites[i].line == line) {
+            return &sites[i];
+        }
+    }
+    /* Two threads missing at a new site at the same time can both add it, which only
+       splits its counts over two entries */
+    seL4_Word i = __atomic_fetch_add(&num_sites, 1, __ATOMIC_RELAXED);
+    if (i >= MAX_SITES) {
+        return NULL;
+    }
+    sites[i].line = line;
+    sites[i].call = call;
+    __atomic_store_n(&sites[i].file, file, __ATOMIC_RELEASE);
+    return &sites[i];
+}
+
+static void record(seL4_Word reasons, const char *file, int line, const char *call)
+{
+    __atomic_fetch_add(&checked_calls, 1, __ATOMIC_RELAXED);
+    /* the load keeps later calls from writing the shared flag, the exchange makes sure that only
+       one of several threads making their first checked call at once registers the dump */
+    if (!__atomic_load_n(&dump_registered, __ATOMIC_RELAXED) &&
+        !__atomic_exchange_n(&dump_registered, true, __ATOMIC_RELAXED)) {
+        atexit(fastpath_dump);
+    }
+    if (reasons == 0) {
+        return;
+    }
+    __atomic_fetch_add(&missed_calls, 1, __ATOMIC_RELAXED);
+    site_t *site = find_site(file, line, call);
+    if (site == NULL) {
+        __atomic_fetch_add(&sites_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    for (int i = 0; i < FASTPATH_NUM_REASONS; i++) {
+        if (reasons & BIT(i)) {
+            __atomic_fetch_add(&site->misses[i], 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* the reasons a message cannot take the fastpath, as a bit mask of fastpath_reason_t */
+static seL4_Word message_reasons(seL4_MessageInfo_t info)
+{
+    seL4_Word reasons = 0;
+    if (seL4_MessageInfo_get_extraCaps(info) > 0) {
+        reasons |= BIT(FASTPATH_EXTRA_CAPS);
+    }
+    if (seL4_MessageInfo_get_length(info) > seL4_FastMessageRegisters) {
+        reasons |= BIT(FASTPATH_LONG_MESSAGE);
+    }
+    return reasons;
+}
+
+seL4_MessageInfo_t fastpath_check_call(seL4_CPtr ep, seL4_MessageInfo_t info, const char *file, int line)
+{
+    seL4_Word reasons = message_reasons(info);
+    if (own_prio_known) {
+        for (seL4_Word i = 0; i < num_endpoints; i++) {
+            if (endpoints[i].ep == ep && endpoints[i].prio < own_prio) {
+                reasons |= BIT(FASTPATH_LOW_PRIORITY);
+            }
+        }
+    }
+    record(reasons, file, line, "seL4_Call");
+    return seL4_Call(ep, info);
+}
+
+#ifdef CONFIG_KERNEL_MCS
+seL4_MessageInfo_t fastpath_check_reply_recv(seL4_CPtr ep, seL4_MessageInfo_t info, seL4_Word *sender,
+                                             seL4_CPtr reply, const char *file, int line)
+{
+    record(message_reasons(info), file, line, "seL4_ReplyRecv");
+    return seL4_ReplyRecv(ep, info, sender, reply);
+}
+#else
+seL4_MessageInfo_t fastpath_check_reply_recv(seL4_CPtr ep, seL4_MessageInfo_t info, seL4_Word *sender,
+                                             const char *file, int line)
+{
+    record(message_reasons(info), file, line, "seL4_ReplyRecv");
+    return seL4_ReplyRecv(ep, info, sender);
+}
+#endif
+
+void fastpath_dump(void)
+{
+    printf("fastpath: %lu of %lu checked calls cannot take the fastpath\n", (unsigned long) missed_calls,
+           (unsigned long) checked_calls);
+    for (seL4_Word i = 0; i < MIN(num_sites, MAX_SITES); i++) {
+        site_t *site = &sites[i];
+        if (site->file == NULL) {
+            continue;
+        }
+        printf("  %s:%d %s:", site->file, site->line, site->call);
+        for (int r = 0; r < FASTPATH_NUM_REASONS; r++) {
+            if (site->misses[r] > 0) {
+                printf(" %s %lu", reason_names[r], (unsigned long) site->misses[r]);
+            }
+        }
+        printf("\n");
+    }
+    if (sites_dropped > 0) {
+        printf("  %lu more calls from other sites\n", (unsigned long) sites_dropped);
+    }
+}
+
+#endif /* CONFIG_DEBUG_BUILD */
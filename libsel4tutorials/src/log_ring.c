@@ -0,0 +1,86 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <sel4/sel4.h>
+#include <arch_stdio.h>
+#include <utils/util.h>
+#include <sel4tutorials/log_ring.h>
+
+/* the ring and notification used by log_ring_stdio_write */
+static log_ring_t *stdio_ring;
+static seL4_CPtr stdio_ntfn;
+
+log_ring_t *log_ring_init(void *buf, size_t buf_size)
+{
+    return ring_init(buf, buf_size, 1);
+}
+
+size_t log_ring_write(log_ring_t *ring, const void *data, size_t count)
+{
+    seL4_Word head = ring->head;
+    seL4_Word tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t n = MIN(count, ring->size - (head - tail));
+    ring_copy_in(ring, head, data, n);
+
+    if (n < count) {
+        __atomic_store_n(&ring->dropped, ring->dropped + count - n, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&ring->head, head + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+size_t log_ring_read(log_ring_t *ring, void *data, size_t count)
+{
+    seL4_Word tail = ring->tail;
+    seL4_Word head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    size_t n = MIN(count, head - tail);
+    ring_copy_out(ring, tail, data, n);
+
+    __atomic_store_n(&ring->tail, tail + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+static size_t log_ring_stdio_write(void *data, size_t count)
+{
+    seL4_Word start = stdio_ring->head;
+    size_t n = log_ring_write(stdio_ring, data, count);
+
+    if (n > 0 && stdio_ntfn != seL4_CapNull) {
+        ring_signal_published(stdio_ring, start, stdio_ntfn);
+    }
+    /* report everything as written, whatever did not fit was dropped and counted */
+    return count;
+}
+
+void log_ring_register_stdio(log_ring_t *ring, seL4_CPtr ntfn)
+{
+    stdio_ring = ring;
+    stdio_ntfn = ntfn;
+    sel4muslcsys_register_stdio_write_fn(log_ring_stdio_write);
+}
+
+size_t log_ring_drain(log_ring_t *ring, size_t (*write)(void *data, size_t count))
+{
+    char buf[128];
+    size_t total = 0;
+    size_t n;
+    while ((n = log_ring_read(ring, buf, sizeof(buf))) > 0) {
+        write(buf, n);
+        total += n;
+    }
+    return total;
+}
+
+size_t log_ring_drain_wait(log_ring_t *ring, size_t (*write)(void *data, size_t count), seL4_CPtr ntfn)
+{
+    while (true) {
+        size_t total = log_ring_drain(ring, write);
+        if (total > 0) {
+            return total;
+        }
+        ring_wait_empty(ring, ntfn);
+    }
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Include Kconfig variables. */
+#include <autoconf.h>
+
+#include <sel4/sel4.h>
+#include <sel4/sel4_arch/mapping.h>
+#include <utils/util.h>
+#include <sel4tutorials/alloc.h>
+#include <sel4tutorials/gen_config.h>
+#include <sel4tutorials/mapping.h>
+
+/* the frame sizes of the architecture, largest first */
+static const seL4_Word frame_sizes[] = {
+#ifdef CONFIG_ARCH_X86
+#ifdef CONFIG_HUGE_PAGE
+    seL4_HugePageBits,
+#endif
+    seL4_LargePageBits,
+#endif
+#ifdef CONFIG_ARCH_AARCH32
+    seL4_SuperSectionBits,
+    seL4_SectionBits,
+    seL4_LargePageBits,
+#endif
+    seL4_PageBits,
+};
+
+/* An intermediate paging structure. lookup_bits is what seL4_MappingFailedLookupLevel reports
+   when the structure is missing, which is also the log2 size of the range it covers. */
+typedef struct paging_structure {
+    seL4_Word type;
+    seL4_Word lookup_bits;
+} paging_structure_t;
+
+static const paging_structure_t paging_structures[] = {
+#ifdef CONFIG_ARCH_X86_64
+    { seL4_X86_PDPTObject, SEL4_MAPPING_LOOKUP_NO_PDPT },
+    { seL4_X86_PageDirectoryObject, SEL4_MAPPING_LOOKUP_NO_PD },
+#endif
+#ifdef CONFIG_ARCH_X86
+    { seL4_X86_PageTableObject, SEL4_MAPPING_LOOKUP_NO_PT },
+#endif
+#ifdef CONFIG_ARCH_AARCH32
+    { seL4_ARM_PageTableObject, SEL4_MAPPING_LOOKUP_NO_PT },
+#endif
+};
+
+static seL4_Error map_page(seL4_CPtr frame, seL4_CPtr vspace, seL4_Word vaddr, seL4_CapRights_t rights,
+                           seL4_Word attrs)
+{
+#ifdef CONFIG_ARCH_X86
+    return seL4_X86_Page_Map(frame, vspace, vaddr, rights, attrs);
+#elif defined(CONFIG_ARCH_ARM)
+    return seL4_ARM_Page_Map(frame, vspace, vaddr, rights, attrs);
+#endif
+}
+
+static seL4_Error map_paging_structure(seL4_Word type, seL4_CPtr cap, seL4_CPtr vspace, seL4_Word vaddr,
+                                       seL4_Word attrs)
+{
+    switch (type) {
+#ifdef CONFIG_ARCH_X86_64
+    case seL4_X86_PDPTObject:
+        return seL4_X86_PDPT_Map(cap, vspace, vaddr, attrs);
+    case seL4_X86_PageDirectoryObject:
+        return seL4_X86_PageDirectory_Map(cap, vspace, vaddr, attrs);
+#endif
+#ifdef CONFIG_ARCH_X86
+    case seL4_X86_PageTableObject:
+        return seL4_X86_PageTable_Map(cap, vspace, vaddr, attrs);
+#endif
+#ifdef CONFIG_ARCH_AARCH32
+    case seL4_ARM_PageTableObject:
+        return seL4_ARM_PageTable_Map(cap, vspace, vaddr, attrs);
+#endif
+    default:
+        ZF_LOGF("Unknown paging structure type %lu", (unsigned long) type);
+        return seL4_InvalidArgument;
+    }
+}
+
+/* return the index in paging_structures of the structure reported missing by a failed lookup */
+static seL4_Word paging_structure_for_lookup(seL4_Word lookup_bits)
+{
+    for (seL4_Word i = 0; i < ARRAY_SIZE(paging_structures); i++) {
+        if (paging_structures[i].lookup_bits == lookup_bits) {
+            return i;
+        }
+    }
+    ZF_LOGF("No paging structure for lookup level %lu", (unsigned long) lookup_bits);
+    return 0;
+}
+
+/*
+ * Map n frames of size 2^frame_bits at vaddr. The frames are frames[i], or first + i if frames is
+ * NULL.
+ *
+ * The region is handled in chunks of up to MAP_CHUNK_BLOCKS blocks, where a block is the range
+ * covered by one of the lowest paging structure the frames need. The first frame of each block is
+ * mapped to find out which paging structures the block is missing. A block inside a range that is
+ * already known to be missing a higher structure is not probed, as it must be missing everything
+ * below it too. The missing structures of each type are then created with one alloc_objects call
+ * and mapped, after which all the other frames are mapped without failing.
+ */
+#define MAP_CHUNK_BLOCKS 64
+
+static void map_frames(seL4_BootInfo *info, seL4_CPtr vspace, seL4_Word vaddr, const seL4_CPtr *frames,
+                       seL4_CPtr first, seL4_Word frame_bits, seL4_Word n, seL4_CapRights_t rights, seL4_Word attrs)
+{
+    /* only the paging structures above the frame size are needed */
+    seL4_Word num_levels = 0;
+    while (num_levels < ARRAY_SIZE(paging_structures) && paging_structures[num_levels].lookup_bits > frame_bits) {
+        num_levels++;
+    }
+    seL4_Word end = vaddr + (n << frame_bits);
+    if (num_levels == 0) {
+        for (seL4_Word i = 0; i < n; i++) {
+            seL4_Error error = map_page(frames ? frames[i] : first + i, vspace, vaddr + (i << frame_bits), rights, attrs);
+            ZF_LOGF_IF(error != seL4_NoError, "Failed to map frame at %p", (void *)(vaddr + (i << frame_bits)));
+        }
+        return;
+    }
+    seL4_Word block_bits = paging_structures[num_levels - 1].lookup_bits;
+
+    seL4_Word chunk = vaddr;
+    while (chunk < end) {
+        seL4_Word missing[ARRAY_SIZE(paging_structures)][MAP_CHUNK_BLOCKS];
+        seL4_Word num_missing[ARRAY_SIZE(paging_structures)] = { 0 };
+        uint64_t probed = 0;
+
+        seL4_Word block = chunk;
+        seL4_Word b;
+        for (b = 0; b < MAP_CHUNK_BLOCKS && block < end; b++) {
+            /* the highest missing structure of the block, or num_levels if it has them all */
+            seL4_Word from = num_levels;
+            for (seL4_Word l = 0; l < num_levels; l++) {
+                seL4_Word base = ROUND_DOWN(block, paging_structures[l].lookup_bits);
+                if (num_missing[l] > 0 && missing[l][num_missing[l] - 1] == base) {
+                    from = l;
+                    break;
+                }
+            }
+            if (from == num_levels) {
+                seL4_Word i = (block - vaddr) >> frame_bits;
+                seL4_Error error = map_page(frames ? frames[i] : first + i, vspace, block, rights, attrs);
+                if (error == seL4_NoError) {
+                    probed |= (1ull << b);
+                } else {
+                    ZF_LOGF_IF(error != seL4_FailedLookup, "Failed to map frame at %p", (void *) block);
+                    from = paging_structure_for_lookup(seL4_MappingFailedLookupLevel());
+                }
+            }
+            for (seL4_Word l = from; l < num_levels; l++) {
+                seL4_Word base = ROUND_DOWN(block, paging_structures[l].lookup_bits);
+                if (num_missing[l] == 0 || missing[l][num_missing[l] - 1] != base) {
+                    missing[l][num_missing[l]++] = base;
+                }
+            }
+            block = MIN(ROUND_DOWN(block, block_bits) + BIT(block_bits), end);
+        }
+        seL4_Word chunk_end = block;
+
+        /* create and map the missing structures, highest first */
+        for (seL4_Word l = 0; l < num_levels; l++) {
+            if (num_missing[l] == 0) {
+                continue;
+            }
+            seL4_CPtr caps = alloc_objects(info, paging_structures[l].type, 0, num_missing[l], NULL);
+            for (seL4_Word k = 0; k < num_missing[l]; k++) {
+                seL4_Error error = map_paging_structure(paging_structures[l].type, caps + k, vspace, missing[l][k], attrs);
+                ZF_LOGF_IF(error != seL4_NoError, "Failed to map paging structure at %p", (void *) missing[l][k]);
+            }
+        }
+
+        /* map every frame in the chunk that was not mapped by a probe */
+        b = 0;
+        for (seL4_Word addr = chunk; addr < chunk_end; addr += BIT(frame_bits)) {
+            bool is_probe = addr == chunk || IS_ALIGNED(addr, block_bits);
+            if (is_probe && addr != chunk) {
+                b++;
+            }
+            if (is_probe && (probed & (1ull << b))) {
+                continue;
+            }
+            seL4_Word i = (addr - vaddr) >> frame_bits;
+            seL4_Error error = map_page(frames ? frames[i] : first + i, vspace, addr, rights, attrs);
+            ZF_LOGF_IF(error != seL4_NoError, "Failed to map frame at %p", (void *) addr);
+        }
+        chunk = chunk_end;
+    }
+}
+
+void map_region(seL4_BootInfo *info, seL4_CPtr vspace, seL4_Word vaddr, const seL4_CPtr *frames, seL4_Word n,
+                seL4_CapRights_t rights, seL4_Word attrs)
+{
+    ZF_LOGF_IF(!IS_ALIGNED(vaddr, seL4_PageBits), "Region must be page aligned");
+    map_frames(info, vspace, vaddr, frames, seL4_CapNull, seL4_PageBits, n, rights, attrs);
+}
+
+/* free the frames of the runs created so far, and leave the region empty */
+static void free_frame_region(seL4_BootInfo *info, frame_region_t *region)
+{
+    for (seL4_Word i = 0; i < region->num_runs; i++) {
+        for (seL4_Word j = 0; j < region->runs[i].count; j++) {
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_RECLAIM
+            free_object(info, region->runs[i].first + j);
+#else
+            /* without the reclaiming allocator the memory of the frames cannot be reused */
+            free_slot(region->runs[i].first + j);
+#endif
+        }
+    }
+    region->num_runs = 0;
+}
+
+seL4_Error alloc_frame_region(seL4_BootInfo *info, seL4_Word vaddr, seL4_Word size, frame_region_t *region)
+{
+    ZF_LOGF_IF(!IS_ALIGNED(vaddr, seL4_PageBits) || !IS_ALIGNED(size, seL4_PageBits),
+               "Frame region must be page aligned");
+    region->vaddr = vaddr;
+    region->size = size;
+    region->num_runs = 0;
+
+    /*
+     * Each run is created as soon as it is planned, so that the number of frames of each size
+     * that still fit is known when the next run is planned. A run uses the largest frame that is
+     * aligned, fits in the rest of the region and fits in some untyped, and ends where a larger
+     * frame becomes possible or the untypeds run out of room for its frames.
+     */
+    seL4_Word end = vaddr + size;
+    for (seL4_Word cur = vaddr; cur < end;) {
+        seL4_Word fit[ARRAY_SIZE(frame_sizes)];
+        seL4_Word bits = seL4_PageBits;
+        seL4_Word max = (end - cur) >> seL4_PageBits;
+        for (seL4_Word i = 0; i < ARRAY_SIZE(frame_sizes); i++) {
+            fit[i] = alloc_object_capacity(info, alloc_frame_type(frame_sizes[i]), 0);
+        }
+        for (seL4_Word i = 0; i < ARRAY_SIZE(frame_sizes); i++) {
+            if (IS_ALIGNED(cur, frame_sizes[i]) && end - cur >= BIT(frame_sizes[i]) && fit[i] > 0) {
+                bits = frame_sizes[i];
+                max = fit[i];
+                break;
+            }
+        }
+
+        seL4_Word count = 0;
+        bool larger = false;
+        while (!larger && count < max && end - cur >= BIT(bits)) {
+            count++;
+            cur += BIT(bits);
+            for (seL4_Word i = 0; i < ARRAY_SIZE(frame_sizes) && frame_sizes[i] > bits; i++) {
+                larger = larger || (IS_ALIGNED(cur, frame_sizes[i]) && end - cur >= BIT(frame_sizes[i]) && fit[i] > 0);
+            }
+        }
+
+        if (region->num_runs == FRAME_REGION_MAX_RUNS) {
+            free_frame_region(info, region);
+            return seL4_RangeError;
+        }
+        frame_run_t *run = &region->runs[region->num_runs++];
+        *run = (frame_run_t) {
+            .vaddr = cur - (count << bits), .frame_bits = bits, .count = count
+        };
+        run->first = alloc_objects(info, alloc_frame_type(bits), 0, count, NULL);
+    }
+    return seL4_NoError;
+}
+
+void map_frame_region(seL4_BootInfo *info, seL4_CPtr vspace, frame_region_t *region, seL4_CapRights_t rights,
+                      seL4_Word attrs)
+{
+    for (seL4_Word i = 0; i < region->num_runs; i++) {
+        frame_run_t *run = &region->runs[i];
+        map_frames(info, vspace, run->vaddr, NULL, run->first, run->frame_bits, run->count, rights, attrs);
+    }
+}
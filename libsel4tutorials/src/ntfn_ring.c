@@ -0,0 +1,69 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/ntfn_ring.h>
+
+ntfn_ring_t *ntfn_ring_init(void *buf, size_t buf_size, size_t item_size)
+{
+    return ring_init(buf, buf_size, item_size);
+}
+
+size_t ntfn_ring_enqueue(ntfn_ring_t *ring, const void *items, size_t count, seL4_CPtr ntfn)
+{
+    /* claim space. This only ever retries if several producers enqueue at once. */
+    seL4_Word start = __atomic_load_n(&ring->reserved, __ATOMIC_RELAXED);
+    size_t n;
+    do {
+        seL4_Word tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        n = MIN(count, ring->size - (start - tail));
+        if (n == 0) {
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&ring->reserved, &start, start + n, false, __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+
+    ring_copy_in(ring, start, items, n);
+
+    /*
+     * Publish in the order the space was claimed, so that the consumer never sees a gap. An
+     * earlier producer that was preempted between claiming and publishing holds this up, so
+     * give it the rest of the timeslice rather than spinning through it.
+     */
+    while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != start) {
+        seL4_Yield();
+    }
+    __atomic_store_n(&ring->head, start + n, __ATOMIC_RELEASE);
+    ring_signal_published(ring, start, ntfn);
+    return n;
+}
+
+size_t ntfn_ring_dequeue(ntfn_ring_t *ring, void *items, size_t count)
+{
+    seL4_Word tail = ring->tail;
+    seL4_Word head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    size_t n = MIN(count, head - tail);
+    if (n == 0) {
+        return 0;
+    }
+    ring_copy_out(ring, tail, items, n);
+    __atomic_store_n(&ring->tail, tail + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+size_t ntfn_ring_dequeue_wait(ntfn_ring_t *ring, void *items, size_t count, seL4_CPtr ntfn)
+{
+    while (true) {
+        for (int i = 0; i < CONFIG_LIB_SEL4_TUTORIALS_NTFN_RING_POLL_SPINS; i++) {
+            size_t n = ntfn_ring_dequeue(ring, items, count);
+            if (n > 0) {
+                return n;
+            }
+        }
+        ring_wait_empty(ring, ntfn);
+    }
+}
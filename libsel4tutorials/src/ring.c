@@ -0,0 +1,65 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <string.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/ring.h>
+
+ring_t *ring_init(void *buf, size_t buf_size, size_t item_size)
+{
+    ZF_LOGF_IF(item_size == 0 || buf_size < sizeof(ring_t) + item_size, "Buffer too small for a ring");
+    ring_t *ring = buf;
+    memset(ring, 0, sizeof(*ring));
+    ring->size = ring_round_size((buf_size - sizeof(ring_t)) / item_size);
+    ring->item_size = item_size;
+    return ring;
+}
+
+/* copy count items between the ring, starting at index, and items */
+static void copy_items(ring_t *ring, seL4_Word index, void *items, size_t count, bool to_ring)
+{
+    seL4_Word offset = index & (ring->size - 1);
+    size_t first = MIN(count, ring->size - offset);
+    char *ring_data = &ring->data[offset * ring->item_size];
+    char *rest = (char *) items + first * ring->item_size;
+    if (to_ring) {
+        memcpy(ring_data, items, first * ring->item_size);
+        memcpy(&ring->data[0], rest, (count - first) * ring->item_size);
+    } else {
+        memcpy(items, ring_data, first * ring->item_size);
+        memcpy(rest, &ring->data[0], (count - first) * ring->item_size);
+    }
+}
+
+void ring_copy_in(ring_t *ring, seL4_Word index, const void *items, size_t count)
+{
+    copy_items(ring, index, (void *) items, count, true);
+}
+
+void ring_copy_out(ring_t *ring, seL4_Word index, void *items, size_t count)
+{
+    copy_items(ring, index, items, count, false);
+}
+
+void ring_signal_published(ring_t *ring, seL4_Word start, seL4_CPtr ntfn)
+{
+    /* pairs with the fence in ring_wait_empty: either the consumer sees the new head and does
+       not wait, or this sees its tail and signals */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == start) {
+        seL4_Signal(ntfn);
+    }
+}
+
+void ring_wait_empty(ring_t *ring, seL4_CPtr ntfn)
+{
+    /* the tail the consumer last stored is published before head is checked */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail) {
+        seL4_Wait(ntfn, NULL);
+    }
+}
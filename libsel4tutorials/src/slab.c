@@ -0,0 +1,124 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <sel4/sel4.h>
+#include <utils/util.h>
+#include <sel4tutorials/alloc.h>
+#include <sel4tutorials/gen_config.h>
+#include <sel4tutorials/slab.h>
+
+#define SLAB_CAPACITY CONFIG_LIB_SEL4_TUTORIALS_SLAB_CAPACITY
+#define SLAB_REFILL MAX(SLAB_CAPACITY / 2, 1)
+
+typedef struct slab {
+    seL4_CPtr objects[SLAB_CAPACITY];
+    seL4_Word count;
+    slab_stats_t stats;
+} slab_t;
+
+static slab_t slabs[seL4_ObjectTypeCount];
+
+static bool is_frame(seL4_Word type)
+{
+    switch (type) {
+#ifdef CONFIG_ARCH_X86
+    case seL4_X86_4K:
+    case seL4_X86_LargePageObject:
+#endif
+#ifdef CONFIG_ARCH_X86_64
+    case seL4_X64_HugePageObject:
+#endif
+#ifdef CONFIG_ARCH_AARCH32
+    case seL4_ARM_SmallPageObject:
+    case seL4_ARM_LargePageObject:
+    case seL4_ARM_SectionObject:
+    case seL4_ARM_SuperSectionObject:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* the types whose objects slab_free can put back as good as new */
+static bool is_cacheable(seL4_Word type)
+{
+    switch (type) {
+    case seL4_EndpointObject:
+    case seL4_NotificationObject:
+    case seL4_TCBObject:
+#ifdef CONFIG_KERNEL_MCS
+    case seL4_ReplyObject:
+#endif
+        return true;
+    default:
+        return is_frame(type);
+    }
+}
+
+/* undo what the holder of an object may have done with it, other than through derived caps */
+static seL4_Error reset_object(seL4_CPtr cslot, seL4_Word type)
+{
+    if (type == seL4_TCBObject) {
+        seL4_Error error = seL4_TCB_Suspend(cslot);
+        return error != seL4_NoError ? error : seL4_TCB_UnbindNotification(cslot);
+    }
+    if (is_frame(type)) {
+#ifdef CONFIG_ARCH_X86
+        return seL4_X86_Page_Unmap(cslot);
+#elif defined(CONFIG_ARCH_ARM)
+        return seL4_ARM_Page_Unmap(cslot);
+#endif
+    }
+    return seL4_NoError;
+}
+
+seL4_CPtr slab_alloc(seL4_BootInfo *info, seL4_Word type)
+{
+    ZF_LOGF_IF(type >= seL4_ObjectTypeCount || !is_cacheable(type), "Object type %lu cannot be cached",
+               (unsigned long) type);
+    slab_t *slab = &slabs[type];
+
+    if (slab->count > 0) {
+        slab->stats.hits++;
+        return slab->objects[--slab->count];
+    }
+
+    slab->stats.misses++;
+    alloc_objects(info, type, 0, SLAB_REFILL, slab->objects);
+    slab->count = SLAB_REFILL - 1;
+    return slab->objects[slab->count];
+}
+
+void slab_free(seL4_BootInfo *info, seL4_CPtr cslot, seL4_Word type)
+{
+    assert(type < seL4_ObjectTypeCount && is_cacheable(type));
+    slab_t *slab = &slabs[type];
+
+    if (slab->count == SLAB_CAPACITY) {
+        slab->stats.overflows++;
+#ifdef CONFIG_LIB_SEL4_TUTORIALS_ALLOC_RECLAIM
+        free_object(info, cslot);
+#else
+        /* without the reclaiming allocator the memory of the object cannot be reused */
+        free_slot(cslot);
+#endif
+        return;
+    }
+
+    seL4_Error error = alloc_revoke(cslot);
+    ZF_LOGF_IF(error != seL4_NoError, "Failed to revoke object");
+    error = reset_object(cslot, type);
+    ZF_LOGF_IF(error != seL4_NoError, "Failed to reset object");
+    slab->stats.frees++;
+    slab->objects[slab->count++] = cslot;
+}
+
+void slab_get_stats(seL4_Word type, slab_stats_t *stats)
+{
+    assert(type < seL4_ObjectTypeCount);
+    *stats = slabs[type].stats;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2018, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <utils/util.h>
+#include <sel4tutorials/ring.h>
+#include <sel4tutorials/trace.h>
+
+__thread trace_buffer_t *trace_current;
+
+trace_buffer_t *trace_init_thread(void *buf, size_t buf_size, uint32_t thread_id)
+{
+    ZF_LOGF_IF(buf_size < sizeof(trace_buffer_t) + sizeof(trace_record_t), "Buffer too small for a trace buffer");
+    trace_buffer_t *buffer = buf;
+    memset(buffer, 0, sizeof(*buffer));
+    seL4_Word records = (buf_size - sizeof(trace_buffer_t)) / sizeof(trace_record_t);
+    buffer->size = ring_round_size(records);
+    buffer->thread_id = thread_id;
+    cycles_init();
+    trace_current = buffer;
+    return buffer;
+}
+
+void trace_dump_buffer(trace_buffer_t *buffer)
+{
+    seL4_Word first = buffer->count > buffer->size ? buffer->count - buffer->size : 0;
+    printf("TRACE BEGIN %u %lu\n", (unsigned) buffer->thread_id, (unsigned long) (buffer->count - first));
+    for (seL4_Word i = first; i < buffer->count; i++) {
+        unsigned char *bytes = (unsigned char *) &buffer->records[i & (buffer->size - 1)];
+        printf("TRACE: ");
+        for (size_t j = 0; j < sizeof(trace_record_t); j++) {
+            printf("%02x", bytes[j]);
+        }
+        printf("\n");
+    }
+    printf("TRACE END\n");
+}
+
+void trace_dump(void)
+{
+    if (trace_current != NULL) {
+        trace_dump_buffer(trace_current);
+    }
+}
@@ -87,5 +87,11 @@ if(FORCE_IOMMU)
     set(KernelIOMMU ON CACHE BOOL "" FORCE)
 endif()
 
+# For the tutorials that time themselves with sel4tutorials/cycles.h, which reads the PMU cycle
+# counter from user level on ARM
+macro(sel4_tutorials_cycle_counter_settings)
+    set(KernelArmExportPMUUser ON CACHE BOOL "" FORCE)
+endmacro()
+
 find_package(sel4-tutorials REQUIRED)
 sel4_tutorials_regenerate_tutorial(${project_dir}/${TUTORIAL_DIR})
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+#
+# Copyright 2018, Data61, CSIRO (ABN 41 687 119 230)
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+
+# Decode the trace buffers printed by trace_dump in libsel4tutorials into text or
+# Chrome trace JSON (which can be loaded in chrome://tracing or Perfetto).
+
+import argparse
+import json
+import struct
+import sys
+
+# trace_record_t: timestamp, event_id, thread_id, a, b
+RECORD = struct.Struct('<QIIQQ')
+
+
+def parse_records(lines):
+    """Return the records in every TRACE BEGIN/TRACE END block of a log, in order"""
+    records = []
+    for line in lines:
+        # the log may have other output on the same line before the trace
+        index = line.find('TRACE: ')
+        if index < 0:
+            continue
+        data = bytes.fromhex(line[index + len('TRACE: '):].strip())
+        if len(data) != RECORD.size:
+            raise ValueError("Truncated trace record: %s" % line.strip())
+        records.append(RECORD.unpack(data))
+    return records
+
+
+def unwrap(records, counter_bits):
+    """Undo the wrapping of a counter narrower than 64 bits, per thread"""
+    if counter_bits >= 64:
+        return records
+    last = {}
+    offset = {}
+    result = []
+    for timestamp, event_id, thread_id, a, b in records:
+        if thread_id in last and timestamp < last[thread_id]:
+            offset[thread_id] = offset.get(thread_id, 0) + (1 << counter_bits)
+        last[thread_id] = timestamp
+        result.append((timestamp + offset.get(thread_id, 0), event_id, thread_id, a, b))
+    return result
+
+
+def load_names(names_file):
+    """Read event names from lines of the form '<event id> <name>'"""
+    names = {}
+    for line in names_file:
+        line = line.strip()
+        if line and not line.startswith('#'):
+            event_id, name = line.split(None, 1)
+            names[int(event_id, 0)] = name
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Decode trace buffers printed by trace_dump in a log of a tutorial run.")
+    parser.add_argument('log', nargs='?', type=argparse.FileType('r'), default=sys.stdin)
+    parser.add_argument('--format', choices=['text', 'chrome'], default='text')
+    parser.add_argument('--names', type=argparse.FileType('r'),
+                        help="File of '<event id> <name>' lines used to name events")
+    parser.add_argument('--cycles-per-us', type=float, default=1.0,
+                        help="Counter frequency in MHz, used to convert timestamps to microseconds")
+    parser.add_argument('--counter-bits', type=int, default=64,
+                        help="Width of the cycle counter, 32 on aarch32")
+    args = parser.parse_args()
+
+    records = unwrap(parse_records(args.log), args.counter_bits)
+    names = load_names(args.names) if args.names else {}
+    start = min((r[0] for r in records), default=0)
+
+    if args.format == 'chrome':
+        events = [{
+            'name': names.get(event_id, 'event %d' % event_id),
+            'ph': 'i',
+            's': 't',
+            'ts': (timestamp - start) / args.cycles_per_us,
+            'pid': 0,
+            'tid': thread_id,
+            'args': {'a': a, 'b': b},
+        } for timestamp, event_id, thread_id, a, b in records]
+        json.dump({'traceEvents': events}, sys.stdout, indent=1)
+        sys.stdout.write('\n')
+    else:
+        for timestamp, event_id, thread_id, a, b in sorted(records):
+            print("%14.3f thread %-3d %-24s a=%#x b=%#x" % ((timestamp - start) / args.cycles_per_us, thread_id,
+                                                          names.get(event_id, 'event %d' % event_id), a, b))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -23,13 +23,18 @@ FAILURE_TEXTS = [
 ]
 
 
-def simulate_with_checks(dir, completion_text, failure_list=FAILURE_TEXTS, logfile=sys.stdout):
+def simulate_with_checks(dir, completion_text, failure_list=FAILURE_TEXTS, logfile=sys.stdout, timeout=10,
+                         num_nodes=1):
 
-    test = pexpect.spawnu("python3", args=["simulate"], cwd=dir)
+    args = ["simulate"]
+    if num_nodes > 1:
+        # an SMP kernel only starts the cores that qemu gives it
+        args.append("--extra-qemu-args=-smp %d" % num_nodes)
+    test = pexpect.spawnu("python3", args=args, cwd=dir)
     test.logfile = logfile
     for i in completion_text.split('\n') + ["\n"]:
         expect_strings = [i] + failure_list
-        result = test.expect(expect_strings, timeout=10)
+        result = test.expect(expect_strings, timeout=timeout)
 
         # result is the index in the completion text list corresponding to the
         # text that was produced
@@ -41,6 +46,8 @@ def simulate_with_checks(dir, completion_text, failure_list=FAILURE_TEXTS, logfi
 def main():
     finish_completion_text = """@FINISH_COMPLETION_TEXT@"""
     start_completion_text = """@START_COMPLETION_TEXT@"""
+    timeout = int("""@COMPLETION_TIMEOUT@""")
+    num_nodes = int("""@COMPLETION_NUM_NODES@""" or 1)
     parser = argparse.ArgumentParser(
         description="Initialize a build directory for completing a tutorial. Invoke from "
         "an empty sub directory, or the tutorials directory, in which case a "
@@ -56,7 +63,7 @@ def main():
     else:
         completion_text = args.text
     build_dir = os.path.dirname(__file__)
-    result = simulate_with_checks(build_dir, completion_text)
+    result = simulate_with_checks(build_dir, completion_text, timeout=timeout, num_nodes=num_nodes)
     if result == 0:
         print("Success!")
     elif result <= len(FAILURE_TEXTS):
@@ -25,8 +25,17 @@ def simulate_block():
 ```'''
 
 
-def ninja_simulate_block():
-    """Print simulate and ninja code block"""
+def ninja_simulate_block(num_nodes=1):
+    """
+    Print simulate and ninja code block. num_nodes is the number of cores of a tutorial that
+    builds an SMP kernel, which qemu must be given.
+    """
+    if num_nodes > 1:
+        return '''
+```sh
+# In build directory
+ninja && ./simulate --extra-qemu-args="-smp %d"
+```''' % num_nodes
     return '''
 ```sh
 # In build directory
@@ -47,13 +56,29 @@ Stuck? See the resources below.
 '''
 
 
-def cmake_check_script(state):
+def benchmark_intro(subject):
+    """Print the start of the first sentence of a benchmark, which is not an exercise"""
+    return 'This is not an exercise but a benchmark of %s' % subject
+
+
+def simulator_timings_note():
+    """Print the note that the timings of a benchmark only mean something on hardware"""
+    return 'Timings in a simulator are not meaningful, so run the benchmark on hardware when the numbers matter.'
+
+
+def cmake_check_script(state, timeout=10):
+    """
+    timeout is how many seconds the simulation may take to print each line of the completion
+    text, for tutorials that take longer than usual to finish.
+    """
     return '''set(FINISH_COMPLETION_TEXT "%s")
 set(START_COMPLETION_TEXT "%s")
+set(COMPLETION_TIMEOUT "%d")
+set(COMPLETION_NUM_NODES "${KernelMaxNumNodes}")
 configure_file(${SEL4_TUTORIALS_DIR}/tools/expect.py ${CMAKE_BINARY_DIR}/check @ONLY)
 include(simulation)
 GenerateSimulateScript()
-''' % (state.print_completion(TaskContentType.COMPLETED), state.print_completion(TaskContentType.BEFORE))
+''' % (state.print_completion(TaskContentType.COMPLETED), state.print_completion(TaskContentType.BEFORE), timeout)
 
 
 def tutorial_init(name):
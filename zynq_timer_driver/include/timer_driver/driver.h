@@ -4,11 +4,20 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#pragma once
+
 #include <utils/util.h>
 
 typedef struct timer_drv {
     uint32_t *reg_base;
     int timer_id;
+    /* what was last written to the control registers, so they never need to be read */
+    uint32_t clk_ctrl;
+    uint32_t cnt_ctrl;
+    uint32_t int_en;
+    /* the clock and deadline of timer_set_deadline */
+    struct timer_clock *clock;
+    uint64_t deadline;
 } timer_drv_t;
 
 int timer_init(timer_drv_t *timer_drv, int timer_id, void *reg_base);
@@ -16,3 +25,74 @@ int timer_set_timeout(timer_drv_t *timer_drv, uint64_t ns, bool periodic);
 int timer_handle_irq(timer_drv_t *timer_drv);
 int timer_start(timer_drv_t *timer_drv);
 int timer_stop(timer_drv_t *timer_drv);
+
+/*
+ * Reload the driver's copies of the control registers from the timer, for when something other
+ * than this driver has changed them, such as a reset of the TTC.
+ */
+int timer_resync(timer_drv_t *timer_drv);
+
+/*
+ * A monotonic nanosecond clock on a TTC timer of its own, which must not be used for timeouts.
+ *
+ * The timer counts through its 16 bits continuously, and interrupts on each wrap and halfway
+ * between. Each interrupt adds the cycles counted since the last one to the clock. Reading the
+ * clock adds the cycles counted since then. Cycles are turned into nanoseconds with a multiply and shift, and
+ * readers use a sequence count instead of a lock, so timer_get_time makes no syscalls and may
+ * be called from any thread.
+ *
+ * Each interrupt must be handled within half a wrap of the counter. A wrap takes
+ * 2^(16 + prescale) / 111 MHz: 590 us with no prescale, 38 ms with a prescale of 6.
+ */
+typedef struct timer_clock {
+    timer_drv_t timer_drv;
+    /* odd while timer_clock_handle_irq is updating the epoch */
+    uint32_t seq;
+    /* the counter value at the epoch */
+    uint32_t epoch_count;
+    /* the time at the epoch, in ns and fractions of a ns */
+    uint64_t epoch_ns;
+    uint64_t epoch_frac;
+    /* ns = cycles * mult >> shift */
+    uint64_t mult;
+    uint32_t shift;
+} timer_clock_t;
+
+/*
+ * Set up and start a timer as a clock.
+ *
+ * @param prescale the counter counts every 2^prescale clock cycles, at most 16
+ */
+int timer_clock_init(timer_clock_t *clock, int timer_id, void *reg_base, int prescale);
+
+/* Handle the interrupt of the clock's timer. */
+int timer_clock_handle_irq(timer_clock_t *clock);
+
+/* @return the time in ns since timer_clock_init */
+uint64_t timer_get_time(timer_clock_t *clock);
+
+/*
+ * Set a one-shot timeout for an absolute deadline on the clock, which can be any time in the
+ * future.
+ *
+ * The timer can only count up to 2^16 cycles, so a long timeout is made of several hardware
+ * timeouts, and each one uses the finest prescale that can reach the deadline. The number of
+ * cycles is rounded down, so a hardware timeout can end a little early, in which case the next
+ * one covers the rest at a finer prescale. Each hardware timeout is worked out from the clock,
+ * so time spent handling the interrupts is not lost.
+ *
+ * The timer is started if it is stopped, so there is no need to call timer_start after
+ * timer_init. It is left running once the deadline has been reached.
+ *
+ * @param clock a clock on a different timer of the TTC
+ * @return 0 on success, or 1 if the deadline has already passed
+ */
+int timer_set_deadline(timer_drv_t *timer_drv, struct timer_clock *clock, uint64_t deadline);
+
+/*
+ * Handle the interrupt of a timer with a deadline set by timer_set_deadline, starting the next
+ * hardware timeout if the deadline has not been reached yet.
+ *
+ * @return 1 if the deadline has been reached, 0 if the timer is waiting for it, or -1 on error
+ */
+int timer_handle_deadline_irq(timer_drv_t *timer_drv);
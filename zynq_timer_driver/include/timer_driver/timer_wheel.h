@@ -0,0 +1,101 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <utils/util.h>
+#include <timer_driver/driver.h>
+
+/*
+ * A hierarchical timer wheel that multiplexes any number of timeouts onto one TTC timer.
+ *
+ * Times are in nanoseconds. The wheel has TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots,
+ * each level covering 6 more bits of the time, so every 64-bit deadline has a place in it.
+ * Inserting and cancelling are O(1). Entries in the higher levels are moved down as their
+ * deadlines approach. The timer is always programmed for the earliest deadline, so it only
+ * fires when a timeout is due.
+ *
+ * The wheel does not read the time itself. Each call is passed the current time, which must
+ * never go backwards.
+ */
+
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS BIT(TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_LEVELS DIV_ROUND_UP(64, TIMER_WHEEL_SLOT_BITS)
+
+typedef struct timer_wheel_entry timer_wheel_entry_t;
+
+typedef void (*timer_wheel_callback_t)(timer_wheel_entry_t *entry, void *cookie);
+
+/*
+ * A timeout. The caller owns the memory of each entry, which must be zeroed before it is first
+ * inserted, and must not touch it while it is in the wheel.
+ */
+struct timer_wheel_entry {
+    timer_wheel_entry_t *next;
+    /* the pointer that points to this entry, or NULL if the entry is not in the wheel */
+    timer_wheel_entry_t **pprev;
+    uint64_t deadline;
+    uint8_t level;
+    uint8_t slot;
+    timer_wheel_callback_t callback;
+    void *cookie;
+};
+
+typedef struct timer_wheel {
+    /* the timer to program, or NULL to only keep track of timeouts */
+    timer_drv_t *timer_drv;
+    /* the time the wheel was last advanced to */
+    uint64_t now;
+    /* the deadline the timer is programmed for, or UINT64_MAX if none */
+    uint64_t programmed;
+    /* which slots of each level have entries */
+    uint64_t occupied[TIMER_WHEEL_LEVELS];
+    timer_wheel_entry_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    /* entries inserted with a deadline that had already passed */
+    timer_wheel_entry_t *due;
+} timer_wheel_t;
+
+/*
+ * Initialise a wheel on a timer that has been set up with timer_init, and start the timer.
+ *
+ * @param timer_drv the timer, or NULL for a wheel that only keeps track of timeouts
+ * @param now the current time
+ */
+int timer_wheel_init(timer_wheel_t *wheel, timer_drv_t *timer_drv, uint64_t now);
+
+/*
+ * Add a timeout. The callback is called from timer_wheel_handle_irq once the deadline has
+ * passed, after which the entry is no longer in the wheel and may be inserted again.
+ *
+ * @param entry that is not already in the wheel
+ * @return 0 on success, or the error from programming the timer
+ */
+int timer_wheel_insert(timer_wheel_t *wheel, timer_wheel_entry_t *entry, uint64_t deadline,
+                       timer_wheel_callback_t callback, void *cookie, uint64_t now);
+
+/*
+ * Remove a timeout that has not expired yet. Does nothing if the entry is not in the wheel.
+ *
+ * A callback may cancel another timeout that expired at the same time, as long as that
+ * timeout's own callback has not been called yet, and it is then not called.
+ *
+ * The timer is left as it is, so this does not need the current time.
+ *
+ * @return 0
+ */
+int timer_wheel_cancel(timer_wheel_t *wheel, timer_wheel_entry_t *entry);
+
+/* @return the earliest deadline in the wheel, or UINT64_MAX if it is empty */
+uint64_t timer_wheel_next_deadline(timer_wheel_t *wheel);
+
+/*
+ * Handle an interrupt from the wheel's timer with timer_handle_irq, or with no timer just move
+ * the wheel to now, and call the callbacks of every timeout that is due.
+ *
+ * @return the number of timeouts that expired, or -1 if the timer could not be programmed
+ */
+int timer_wheel_handle_irq(timer_wheel_t *wheel, uint64_t now);
@@ -34,6 +34,12 @@
 #define PCLK_FREQ 111000000UL
 #define PRESCALE_MAX 0xf
 
+/* The longest hardware timeout that timer_set_deadline uses, half of the most the timer can do
+   so that rounding never pushes it past the largest prescale */
+#define DEADLINE_SEGMENT_MAX_NS (((uint64_t) INTERVAL_CNT_MAX << PRESCALE_MAX) * NS_IN_S / PCLK_FREQ / 2)
+/* The shortest, so that the match value is not passed before it is written */
+#define DEADLINE_SEGMENT_MIN_NS 1000
+
 static inline uint32_t timer_get_register(timer_drv_t *timer_drv, size_t offset)
 {
     assert(timer_drv);
@@ -48,31 +54,89 @@ static inline void timer_set_register(timer_drv_t *timer_drv, size_t offset, uin
     *target_reg = value;
 }
 
+/*
+ * The control registers are only ever written, through these, which keep a copy of what was
+ * written so that changing some of the bits does not need a slow device read first.
+ */
+static inline void timer_set_clk_ctrl(timer_drv_t *timer_drv, uint32_t clk_ctrl)
+{
+    timer_drv->clk_ctrl = clk_ctrl;
+    timer_set_register(timer_drv, CLK_CTRL_OFFSET, clk_ctrl);
+}
+
+static inline void timer_set_cnt_ctrl(timer_drv_t *timer_drv, uint32_t cnt_ctrl)
+{
+    /* the reset bit clears itself once the counter has been reset */
+    timer_drv->cnt_ctrl = cnt_ctrl & ~CNT_CTRL_RST;
+    timer_set_register(timer_drv, CNT_CTRL_OFFSET, cnt_ctrl);
+}
+
+static inline void timer_set_int_en(timer_drv_t *timer_drv, uint32_t int_en)
+{
+    timer_drv->int_en = int_en;
+    timer_set_register(timer_drv, INT_EN_OFFSET, int_en);
+}
+
+/*
+ * The timeouts each prescale can count, and how to turn them into cycles without dividing,
+ * which the Cortex-A9 can only do in software.
+ *
+ * The counter runs at PCLK_FREQ >> prescale. A prescale can count timeouts of up to max_ns,
+ * and a timeout of ns is (ns * mult) >> PRESCALE_MULT_SHIFT cycles. mult is rounded down, so
+ * this is never more than the cycles worked out with a divide, and at most one less.
+ */
+#define PRESCALE_MULT_SHIFT 48
+/* log2 of the longest timeout without a prescale, rounded down */
+#define PRESCALE_LOOKUP_BITS 19
+#define PRESCALE_FREQ(p) ((uint64_t) (PCLK_FREQ >> (p)))
+/* floor(PRESCALE_FREQ(p) * 2^48 / NS_IN_S), in two steps so that nothing overflows */
+#define PRESCALE_MULT(p) ((((PRESCALE_FREQ(p) << 32) / NS_IN_S) << 16) + \
+                          ((((PRESCALE_FREQ(p) << 32) % NS_IN_S) << 16) / NS_IN_S))
+#define PRESCALE_ENTRY(p) { \
+    .max_ns = (uint64_t) INTERVAL_CNT_MAX * NS_IN_S / PRESCALE_FREQ(p), \
+    .mult = PRESCALE_MULT(p), \
+}
+
+typedef struct prescale_entry {
+    uint64_t max_ns;
+    uint64_t mult;
+} prescale_entry_t;
+
+static const prescale_entry_t prescale_table[PRESCALE_MAX + 1] = {
+    PRESCALE_ENTRY(0), PRESCALE_ENTRY(1), PRESCALE_ENTRY(2), PRESCALE_ENTRY(3),
+    PRESCALE_ENTRY(4), PRESCALE_ENTRY(5), PRESCALE_ENTRY(6), PRESCALE_ENTRY(7),
+    PRESCALE_ENTRY(8), PRESCALE_ENTRY(9), PRESCALE_ENTRY(10), PRESCALE_ENTRY(11),
+    PRESCALE_ENTRY(12), PRESCALE_ENTRY(13), PRESCALE_ENTRY(14), PRESCALE_ENTRY(15),
+};
+
 static int timer_set_freq_for_ns(timer_drv_t *timer_drv, uint64_t ns, uint64_t *ret_interval)
 {
     assert(ret_interval);
 
-    uint64_t required_freq = freq_cycles_and_ns_to_hz(INTERVAL_CNT_MAX, ns);
-
-    /* Find a prescale value that gets us close to the required frequency */
-    int prescale = 0;
-    uint64_t curr_freq = PCLK_FREQ;
-    for (prescale = 0; curr_freq > required_freq; prescale++, curr_freq >>= 1);
+    /*
+     * Find the smallest prescale that can count the timeout. Each prescale counts timeouts
+     * twice as long as the one before, so the log2 of the timeout gives a prescale at most
+     * one short of it.
+     */
+    int prescale = MAX((63 - CLZLL(ns | 1)) - PRESCALE_LOOKUP_BITS, 0);
+    while (prescale <= PRESCALE_MAX && ns > prescale_table[prescale].max_ns) {
+        prescale++;
+    }
     if (prescale > PRESCALE_MAX) {
         /* Couldn't find a suitable value for the prescale */
         return -1;
     }
 
     /* Set the prescale */
-    uint32_t to_set = timer_get_register(timer_drv, CLK_CTRL_OFFSET) & ~CLK_CTRL_PRESCALE_MASK;
+    uint32_t to_set = timer_drv->clk_ctrl & ~CLK_CTRL_PRESCALE_MASK;
     if (prescale > 0) {
         to_set |= CLK_CTRL_PRESCALE_ENABLE | CLK_CTRL_PRESCALE_VAL(prescale - 1);
     } else {
         to_set &= ~CLK_CTRL_PRESCALE_ENABLE;
     }
-    timer_set_register(timer_drv, CLK_CTRL_OFFSET, to_set);
+    timer_set_clk_ctrl(timer_drv, to_set);
 
-    *ret_interval = freq_ns_and_hz_to_cycles(ns, curr_freq);
+    *ret_interval = (ns * prescale_table[prescale].mult) >> PRESCALE_MULT_SHIFT;
     assert(*ret_interval <= INTERVAL_CNT_MAX);
 
     return 0;
@@ -81,10 +145,8 @@ static int timer_set_freq_for_ns(timer_drv_t *timer_drv, uint64_t ns, uint64_t *
 static void timer_periodic_timeout(timer_drv_t *timer_drv, uint64_t counter_val)
 {
     timer_set_register(timer_drv, INTERVAL_OFFSET, counter_val);
-    uint32_t cnt_ctrl = timer_get_register(timer_drv, CNT_CTRL_OFFSET);
-    cnt_ctrl |= CNT_CTRL_INT;
-    timer_set_register(timer_drv, CNT_CTRL_OFFSET, cnt_ctrl);
-    timer_set_register(timer_drv, INT_EN_OFFSET, INT_EN_INTERVAL);
+    timer_set_cnt_ctrl(timer_drv, timer_drv->cnt_ctrl | CNT_CTRL_INT);
+    timer_set_int_en(timer_drv, INT_EN_INTERVAL);
 }
 
 static void timer_oneshot_timeout(timer_drv_t *timer_drv, uint64_t counter_val)
@@ -94,10 +156,8 @@ static void timer_oneshot_timeout(timer_drv_t *timer_drv, uint64_t counter_val)
     timer_set_register(timer_drv, MATCH0_OFFSET, match_to_set);
 
     /* Turn off interval interrupts and turn on the match interrupt */
-    uint32_t cnt_ctrl = timer_get_register(timer_drv, CNT_CTRL_OFFSET);
-    cnt_ctrl &= ~CNT_CTRL_INT;
-    timer_set_register(timer_drv, CNT_CTRL_OFFSET, cnt_ctrl);
-    timer_set_register(timer_drv, INT_EN_OFFSET, INT_EN_MATCH0);
+    timer_set_cnt_ctrl(timer_drv, timer_drv->cnt_ctrl & ~CNT_CTRL_INT);
+    timer_set_int_en(timer_drv, INT_EN_MATCH0);
 }
 
 int timer_set_timeout(timer_drv_t *timer_drv, uint64_t ns, bool periodic)
@@ -123,11 +183,9 @@ int timer_handle_irq(timer_drv_t *timer_drv)
 {
     assert(timer_drv);
     /* Read the interrupt status register to clear the interrupt bit */
-    FORCE_READ(timer_drv->reg_base + (INT_STS_OFFSET / sizeof(uint32_t)));
+    timer_get_register(timer_drv, INT_STS_OFFSET);
 
-    uint32_t int_en = timer_get_register(timer_drv, INT_EN_OFFSET);
-    int_en &= ~INT_EN_MATCH0;
-    timer_set_register(timer_drv, INT_EN_OFFSET, int_en);
+    timer_set_int_en(timer_drv, timer_drv->int_en & ~INT_EN_MATCH0);
 
     return 0;
 }
@@ -135,18 +193,23 @@ int timer_handle_irq(timer_drv_t *timer_drv)
 int timer_start(timer_drv_t *timer_drv)
 {
     assert(timer_drv);
-    uint32_t cnt_ctrl = timer_get_register(timer_drv, CNT_CTRL_OFFSET);
-    cnt_ctrl &= ~CNT_CTRL_STOP;
-    timer_set_register(timer_drv, CNT_CTRL_OFFSET, cnt_ctrl);
+    timer_set_cnt_ctrl(timer_drv, timer_drv->cnt_ctrl & ~CNT_CTRL_STOP);
     return 0;
 }
 
 int timer_stop(timer_drv_t *timer_drv)
 {
     assert(timer_drv);
-    uint32_t cnt_ctrl = timer_get_register(timer_drv, CNT_CTRL_OFFSET);
-    cnt_ctrl |= CNT_CTRL_STOP;
-    timer_set_register(timer_drv, CNT_CTRL_OFFSET, cnt_ctrl);
+    timer_set_cnt_ctrl(timer_drv, timer_drv->cnt_ctrl | CNT_CTRL_STOP);
+    return 0;
+}
+
+int timer_resync(timer_drv_t *timer_drv)
+{
+    assert(timer_drv);
+    timer_drv->clk_ctrl = timer_get_register(timer_drv, CLK_CTRL_OFFSET);
+    timer_drv->cnt_ctrl = timer_get_register(timer_drv, CNT_CTRL_OFFSET) & ~CNT_CTRL_RST;
+    timer_drv->int_en = timer_get_register(timer_drv, INT_EN_OFFSET);
     return 0;
 }
 
@@ -158,16 +221,147 @@ int timer_init(timer_drv_t *timer_drv, int timer_id, void *reg_base)
 
     timer_drv->reg_base = reg_base;
     timer_drv->timer_id = timer_id;
+    timer_drv->clock = NULL;
+    timer_drv->deadline = 0;
 
-    timer_set_register(timer_drv, INT_EN_OFFSET, 0);
-    FORCE_READ(timer_drv->reg_base + (INT_STS_OFFSET / sizeof(uint32_t))); /* Force a read to clear the register */
+    timer_set_int_en(timer_drv, 0);
+    timer_get_register(timer_drv, INT_STS_OFFSET); /* Force a read to clear the register */
     uint32_t set_value = CNT_CTRL_STOP | CNT_CTRL_INT | CNT_CTRL_MATCH | CNT_CTRL_RST;
-    timer_set_register(timer_drv, CNT_CTRL_OFFSET, set_value);
-    timer_set_register(timer_drv, CLK_CTRL_OFFSET, set_value);
+    timer_set_cnt_ctrl(timer_drv, set_value);
+    timer_set_clk_ctrl(timer_drv, set_value);
     set_value = INT_EN_INTERVAL;
-    timer_set_register(timer_drv, INT_EN_OFFSET, set_value);
+    timer_set_int_en(timer_drv, set_value);
     set_value = INTERVAL_CNT_MAX;
     timer_set_register(timer_drv, INTERVAL_OFFSET, INTERVAL_CNT_MAX);
 
     return 0;
 }
+
+/* the bits of a clock's fractions of a ns */
+#define CLOCK_FRAC_MASK(clock) ((1ull << (clock)->shift) - 1)
+
+/* The cycles counted since the epoch, which the interrupts keep within one wrap */
+static inline uint64_t clock_cycles_since_epoch(timer_clock_t *clock, uint32_t count)
+{
+    return (count - clock->epoch_count) & INTERVAL_CNT_MAX;
+}
+
+int timer_clock_init(timer_clock_t *clock, int timer_id, void *reg_base, int prescale)
+{
+    assert(clock);
+    assert(0 <= prescale && prescale <= PRESCALE_MAX + 1);
+
+    int error = timer_init(&clock->timer_drv, timer_id, reg_base);
+    if (error) {
+        return error;
+    }
+    timer_drv_t *timer_drv = &clock->timer_drv;
+    uint32_t clk_ctrl = 0;
+    if (prescale > 0) {
+        clk_ctrl = CLK_CTRL_PRESCALE_ENABLE | CLK_CTRL_PRESCALE_VAL(prescale - 1);
+    }
+    timer_set_clk_ctrl(timer_drv, clk_ctrl);
+
+    /*
+     * Pick the largest shift for which a whole wrap of cycles times mult, plus a fraction
+     * of a ns, still fits in 64 bits. A cycle is at most 2^(prescale + 4) ns.
+     */
+    clock->shift = 64 - 1 - INTERVAL_CNT_WIDTH - (prescale + 4);
+    /* mult = (NS_IN_S << prescale << shift) / PCLK_FREQ, a bit at a time so nothing overflows */
+    uint64_t numerator = NS_IN_S << prescale;
+    uint64_t mult = numerator / PCLK_FREQ;
+    uint64_t rem = numerator % PCLK_FREQ;
+    for (int i = 0; i < clock->shift; i++) {
+        mult <<= 1;
+        rem <<= 1;
+        if (rem >= PCLK_FREQ) {
+            mult |= 1;
+            rem -= PCLK_FREQ;
+        }
+    }
+    clock->mult = mult;
+    clock->seq = 0;
+    clock->epoch_count = 0;
+    clock->epoch_ns = 0;
+    clock->epoch_frac = 0;
+
+    /*
+     * timer_init left the counter reset and in interval mode over the whole range. Interrupt
+     * halfway through as well as on the wrap, so that the interrupts are never a whole wrap
+     * apart, which would be indistinguishable from no time passing.
+     */
+    timer_set_register(timer_drv, MATCH0_OFFSET, BIT(INTERVAL_CNT_WIDTH - 1));
+    timer_set_int_en(timer_drv, INT_EN_INTERVAL | INT_EN_MATCH0);
+    return timer_start(timer_drv);
+}
+
+int timer_clock_handle_irq(timer_clock_t *clock)
+{
+    assert(clock);
+    timer_drv_t *timer_drv = &clock->timer_drv;
+    /* Read the interrupt status register to clear the interrupt bit */
+    timer_get_register(timer_drv, INT_STS_OFFSET);
+
+    __atomic_store_n(&clock->seq, clock->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    uint32_t count = timer_get_register(timer_drv, CNT_VAL_OFFSET);
+    uint64_t acc = clock->epoch_frac + clock_cycles_since_epoch(clock, count) * clock->mult;
+    clock->epoch_ns += acc >> clock->shift;
+    clock->epoch_frac = acc & CLOCK_FRAC_MASK(clock);
+    clock->epoch_count = count;
+
+    __atomic_store_n(&clock->seq, clock->seq + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+uint64_t timer_get_time(timer_clock_t *clock)
+{
+    assert(clock);
+    uint32_t seq;
+    uint64_t ns;
+    do {
+        seq = __atomic_load_n(&clock->seq, __ATOMIC_ACQUIRE);
+        uint32_t count = timer_get_register(&clock->timer_drv, CNT_VAL_OFFSET);
+        uint64_t cycles = clock_cycles_since_epoch(clock, count);
+        ns = clock->epoch_ns + ((clock->epoch_frac + cycles * clock->mult) >> clock->shift);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&clock->seq, __ATOMIC_RELAXED));
+    return ns;
+}
+
+/* Start the next hardware timeout towards the deadline. Returns 1 if it has been reached. */
+static int timer_deadline_segment(timer_drv_t *timer_drv)
+{
+    uint64_t now = timer_get_time(timer_drv->clock);
+    if (now >= timer_drv->deadline) {
+        return 1;
+    }
+
+    uint64_t ns = MIN(MAX(timer_drv->deadline - now, DEADLINE_SEGMENT_MIN_NS), DEADLINE_SEGMENT_MAX_NS);
+    uint64_t counter_interval = 0;
+    int error = timer_set_freq_for_ns(timer_drv, ns, &counter_interval);
+    if (error) {
+        return -1;
+    }
+    timer_oneshot_timeout(timer_drv, counter_interval);
+    /* timer_init leaves the counter stopped, and the match value is relative to where it is */
+    timer_start(timer_drv);
+    return 0;
+}
+
+int timer_set_deadline(timer_drv_t *timer_drv, timer_clock_t *clock, uint64_t deadline)
+{
+    assert(timer_drv);
+    assert(clock && &clock->timer_drv != timer_drv);
+    timer_drv->clock = clock;
+    timer_drv->deadline = deadline;
+    return timer_deadline_segment(timer_drv);
+}
+
+int timer_handle_deadline_irq(timer_drv_t *timer_drv)
+{
+    assert(timer_drv && timer_drv->clock);
+    timer_handle_irq(timer_drv);
+    return timer_deadline_segment(timer_drv);
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Timer wheel multiplexing timeouts onto one TTC timer */
+
+#include <string.h>
+#include <timer_driver/timer_wheel.h>
+
+/* the bit for a slot in an occupied mask */
+#define SLOT_BIT(slot) (1ull << (slot))
+
+/* the level of the entries in the due list */
+#define DUE_LEVEL TIMER_WHEEL_LEVELS
+
+/* timer_set_timeout cannot program timeouts longer than about 19 s, so longer ones are split up */
+#define MAX_TIMEOUT_NS (10 * NS_IN_S)
+/* a match value that is too close to the counter would only match after the counter wraps */
+#define MIN_TIMEOUT_NS 1000
+
+static inline uint64_t digit(uint64_t time, int level)
+{
+    return (time >> (level * TIMER_WHEEL_SLOT_BITS)) & MASK(TIMER_WHEEL_SLOT_BITS);
+}
+
+static void list_push(timer_wheel_entry_t **head, timer_wheel_entry_t *entry)
+{
+    entry->next = *head;
+    if (entry->next) {
+        entry->next->pprev = &entry->next;
+    }
+    entry->pprev = head;
+    *head = entry;
+}
+
+/*
+ * Put an entry in the wheel. An entry belongs in the level of the highest digit in which its
+ * deadline differs from the time of the wheel, in the slot for that digit. Entries that are
+ * already due go to the due list.
+ */
+static void place(timer_wheel_t *wheel, timer_wheel_entry_t *entry)
+{
+    if (entry->deadline <= wheel->now) {
+        entry->level = DUE_LEVEL;
+        list_push(&wheel->due, entry);
+        return;
+    }
+    int level = (63 - CLZLL(entry->deadline ^ wheel->now)) / TIMER_WHEEL_SLOT_BITS;
+    int slot = digit(entry->deadline, level);
+    entry->level = level;
+    entry->slot = slot;
+    list_push(&wheel->slots[level][slot], entry);
+    wheel->occupied[level] |= SLOT_BIT(slot);
+}
+
+/*
+ * Move an entry onto the expired list. It stays linked, so that a callback can still cancel it
+ * before its own callback has been called.
+ */
+static void expire(timer_wheel_entry_t *entry, timer_wheel_entry_t **expired)
+{
+    entry->level = DUE_LEVEL;
+    list_push(expired, entry);
+}
+
+/* move a whole list onto the front of the expired list */
+static void expire_list(timer_wheel_entry_t *list, timer_wheel_entry_t **expired)
+{
+    while (list) {
+        timer_wheel_entry_t *next = list->next;
+        expire(list, expired);
+        list = next;
+    }
+}
+
+static timer_wheel_entry_t *take_slot(timer_wheel_t *wheel, int level, int slot)
+{
+    timer_wheel_entry_t *list = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~SLOT_BIT(slot);
+    return list;
+}
+
+/*
+ * Move the wheel forward to now, adding every entry that is due to the expired list.
+ *
+ * If the highest digit that changes is in level top, every entry below level top is due, as
+ * are the entries in level top with a digit below the new one. The entries with the new digit
+ * are placed again, which moves them down the wheel. Nothing above level top is affected.
+ */
+static void advance(timer_wheel_t *wheel, uint64_t now, timer_wheel_entry_t **expired)
+{
+    if (now <= wheel->now) {
+        return;
+    }
+    uint64_t old = wheel->now;
+    int top = (63 - CLZLL(old ^ now)) / TIMER_WHEEL_SLOT_BITS;
+    wheel->now = now;
+
+    for (int level = 0; level < top; level++) {
+        while (wheel->occupied[level]) {
+            expire_list(take_slot(wheel, level, CTZLL(wheel->occupied[level])), expired);
+        }
+    }
+
+    uint64_t new_digit = digit(now, top);
+    uint64_t passed = wheel->occupied[top] & (SLOT_BIT(new_digit) - 1);
+    while (passed) {
+        int slot = CTZLL(passed);
+        passed &= ~SLOT_BIT(slot);
+        expire_list(take_slot(wheel, top, slot), expired);
+    }
+    timer_wheel_entry_t *list = take_slot(wheel, top, new_digit);
+    while (list) {
+        timer_wheel_entry_t *next = list->next;
+        if (list->deadline <= now) {
+            expire(list, expired);
+        } else {
+            place(wheel, list);
+        }
+        list = next;
+    }
+}
+
+uint64_t timer_wheel_next_deadline(timer_wheel_t *wheel)
+{
+    if (wheel->due) {
+        return wheel->now;
+    }
+    /* the lowest level with entries has the earliest ones, and its first slot the earliest of those */
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (wheel->occupied[level]) {
+            timer_wheel_entry_t *entry = wheel->slots[level][CTZLL(wheel->occupied[level])];
+            uint64_t earliest = entry->deadline;
+            for (entry = entry->next; entry; entry = entry->next) {
+                earliest = MIN(earliest, entry->deadline);
+            }
+            return earliest;
+        }
+    }
+    return UINT64_MAX;
+}
+
+static int program(timer_wheel_t *wheel, uint64_t deadline, uint64_t now)
+{
+    wheel->programmed = deadline;
+    if (!wheel->timer_drv || deadline == UINT64_MAX) {
+        return 0;
+    }
+    uint64_t ns = deadline > now ? deadline - now : 0;
+    ns = MIN(MAX(ns, MIN_TIMEOUT_NS), MAX_TIMEOUT_NS);
+    return timer_set_timeout(wheel->timer_drv, ns, false);
+}
+
+int timer_wheel_init(timer_wheel_t *wheel, timer_drv_t *timer_drv, uint64_t now)
+{
+    assert(wheel);
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->timer_drv = timer_drv;
+    wheel->now = now;
+    wheel->programmed = UINT64_MAX;
+    if (timer_drv) {
+        return timer_start(timer_drv);
+    }
+    return 0;
+}
+
+int timer_wheel_insert(timer_wheel_t *wheel, timer_wheel_entry_t *entry, uint64_t deadline,
+                       timer_wheel_callback_t callback, void *cookie, uint64_t now)
+{
+    assert(wheel);
+    assert(entry && !entry->pprev);
+    entry->deadline = deadline;
+    entry->callback = callback;
+    entry->cookie = cookie;
+    place(wheel, entry);
+    if (deadline < wheel->programmed) {
+        return program(wheel, deadline, now);
+    }
+    return 0;
+}
+
+int timer_wheel_cancel(timer_wheel_t *wheel, timer_wheel_entry_t *entry)
+{
+    assert(wheel && entry);
+    if (!entry->pprev) {
+        return 0;
+    }
+    *entry->pprev = entry->next;
+    if (entry->next) {
+        entry->next->pprev = entry->pprev;
+    }
+    entry->pprev = NULL;
+    if (entry->level != DUE_LEVEL && !wheel->slots[entry->level][entry->slot]) {
+        wheel->occupied[entry->level] &= ~SLOT_BIT(entry->slot);
+    }
+    /* The timer is left programmed, so if this was the earliest entry the next interrupt comes
+       early and finds nothing due. That is cheaper than finding the next deadline now. */
+    return 0;
+}
+
+int timer_wheel_handle_irq(timer_wheel_t *wheel, uint64_t now)
+{
+    assert(wheel);
+    if (wheel->timer_drv) {
+        timer_handle_irq(wheel->timer_drv);
+    }
+    wheel->programmed = UINT64_MAX;
+
+    timer_wheel_entry_t *expired = NULL;
+    expire_list(wheel->due, &expired);
+    wheel->due = NULL;
+    advance(wheel, now, &expired);
+
+    /* the callbacks may insert entries again, including their own, and cancel the entries
+       that are still on the expired list */
+    int count = 0;
+    while (expired) {
+        timer_wheel_entry_t *entry = expired;
+        expired = entry->next;
+        if (expired) {
+            expired->pprev = &expired;
+        }
+        entry->next = NULL;
+        entry->pprev = NULL;
+        entry->callback(entry, entry->cookie);
+        count++;
+    }
+
+    uint64_t next = timer_wheel_next_deadline(wheel);
+    if (next < wheel->programmed) {
+        int error = program(wheel, next, now);
+        if (error) {
+            return error;
+        }
+    }
+    return count;
+}